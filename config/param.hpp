@@ -16,14 +16,14 @@ const uint32_t CACHE_GEN = 4;
 const uint32_t END_EXP = 5;
 const uint32_t DEAD_SEND = 6;
 const uint32_t DUMMY = 7;
+const uint32_t ACK = 8;
+const uint32_t QUERY = 9;
+const uint32_t REPLICA = 10;
 
 // ver_id_ のマスク
 const uint32_t MASK_VER = (1 << 7) + (1 << 6) + (1 << 5) + (1 << 4);
 const uint32_t MASK_MESSEGEID = (1 << 3) + (1 << 2) + (1 << 1) + (1 << 0);
 
-// procMessage の中断用フラグ
-bool PROC_MESSAGE_FLAG = true;
-
 // RW 終了時に checkRWer をするかどうか
 bool CHECK_RWER_FLAG = false;
 
@@ -33,33 +33,48 @@ bool CACHE_GEN_FLAG = true;
 // メインの実験が始まっているかどうか
 bool MAIN_EX = true;
 
+// RWer 送信時に経路情報を落として現在の状態だけを送るか
+// (キャッシュ学習中 (CHECK_RWER_FLAG), コーパス出力中 (CORPUS_OUTPUT_FLAG), 全訪問頂点での PPR 推定中 (PPR_VISIT_ALL_FLAG) は経路情報が必要なので縮めない)
+// (メイン実行中のキャッシュ学習 (CACHE_LEARN_MAIN_FLAG) に使う RWer も縮めない)
+bool COMPACT_RWER_FLAG = true;
+
 ////////////////////////////////////////////////////
 // 自分で設定
 
 // RW の α
 const double ALPHA = 0.15;
 
-// データ構造の初期化用 (全グラフの頂点数の数よりも大きく設定する)
-// 実装簡易化のために配列のサイズを先に指定する
-// もしより現実的な実験する場合は全グラフの頂点数はわからないためこのパラメタは使うべきでない
-// その場合 unordered_map 等を使ってグラフデータの管理を行うことになる
-const uint64_t VERTEX_SIZE = 5000000;
+// SimpleCache (キャッシュした隣接リストのハッシュ表) に使うメモリ (Byte). 1 エントリ 32B で, この範囲で最大の 2 の冪のスロット数にする
+// グラフデータは頂点数に依存しないローカル ID で管理するので, 全グラフの頂点数を事前に指定する必要はない
+const uint64_t CACHE_TABLE_MEMORY = 64ULL << 20;
+
+// SimpleCache のスロットの使用率の上限. 追い出しをしない (CACHE_EVICTION_FLAG が false の) ときは, これを超えるとキャッシュ生成を止める
+const double CACHE_TABLE_MAX_LOAD = 0.75;
+
+// SimpleCache で探索範囲が埋まっていたら CLOCK で追い出して学習を続けるか (false なら使用率の上限に達した時点でキャッシュを固定する)
+bool CACHE_EVICTION_FLAG = true;
 
-// 「cacheエッジ数 + 元々持ってるエッジ数」の最大値
-const uint32_t MAX_CACHE_SIZE = 200;
+// SimpleCache で 1 つのキーを探すスロット数の上限 (追い出す候補もこの範囲から選ぶ)
+const uint32_t CACHE_PROBE_LIMIT = 16;
+
+// メイン実行中も RWer の経路でキャッシュを学習し続けるか, 学習に使う RWer の割合 (CACHE_LEARN_MAIN_INTERVAL 個に 1 個. その RWer だけ経路を縮めずに送る)
+bool CACHE_LEARN_MAIN_FLAG = true;
+const uint32_t CACHE_LEARN_MAIN_INTERVAL = 16;
 
 // cache 用の実行における RWer の最大生成数
 const uint64_t MAX_RWER_NUM_FOR_CACHE = 100000;
 
-// RW の実行ステップ (RW_STEP 回実行するごとに少しスリープ)
+// RW の実行ステップ (RW_STEP 個生成するごとに少し生成を休む)
 const uint32_t RW_STEP = 500000; // cache 補充用の実行
 
-// RWer 生成の sleep 時間 (s)
+// RWer 生成を休む時間 (s)
 const uint32_t GENERATE_SLEEP_TIME = 4; // cache 補充用の実行
 
-// message 処理スレッドの数
-uint32_t PROC_MESSAGE_THREAD_NUM = 15;       // メイン実行用
-uint32_t PROC_MESSAGE_CACHE_THREAD_NUM = 10; // cache 補充用の実行
+// RWer の生成と処理をするスレッド (walkEngine) の数. メイン実行と cache 補充用の実行で共通 (コア数程度にする)
+uint32_t WALK_THREAD_NUM = 16;
+
+// walkEngine スレッドをコアに固定するか (スレッド i をコア i % コア数 に固定)
+bool PIN_WALK_THREAD_FLAG = true;
 
 // 送信キューの数 (サーバ数、グラフ分割数)
 uint32_t SEND_QUEUE_NUM = 5;
@@ -67,10 +82,101 @@ uint32_t SEND_QUEUE_NUM = 5;
 // 受信スレッド数 (実験で使用するポート番号数)
 const uint32_t RECV_PORT = 4;
 
-// RWer 生成スレッド数
-const uint32_t GENERATE_RWER_THREAD_NUM = 15;      // メイン実行用
-const uint32_t GENERATE_RWER_CACHE_THREAD_NUM = 4; // cache 補充用の実行
+// 1 スレッドが交互に進める RWer の数 (プリフェッチの待ち時間を隠すためのバッチ)
+const uint32_t WALK_BATCH_SIZE = 16;
+
+// walkEngine スレッドが 1 度に実行する RWer の数 (受信した RWer で埋まらない分だけ新しく生成する)
+const uint32_t GENERATE_RWER_CHUNK = 256;
+
+// RWer のプールでスレッド間 (デポ) を受け渡す空きブロックの束の大きさ (スラブ 1 つ分のブロック数)
+const uint32_t WALKER_POOL_BATCH = 256;
+
+// メッセージキュー (RWer_queue_, send_queue_) 1 本あたりの容量 (2 の冪). 満杯のときは push 側が空くまで待つ
+const uint32_t MESSAGE_QUEUE_CAPACITY = 1 << 17;
+
+// RWer 内に直接持つ path_ の長さ (64bit 単位). これを超える RWer だけヒープに確保する
+const uint32_t PATH_INLINE_SIZE = 64;
 
 // メッセージ長  ここを小さくすればメッセージは一つづつ送られることになるのか
 const uint32_t MESSAGE_MAX_LENGTH_SEND = 8950;
-const uint32_t MESSAGE_MAX_LENGTH_RECV = 8950;
\ No newline at end of file
+const uint32_t MESSAGE_MAX_LENGTH_RECV = 8950;
+
+// sendmmsg / recvmmsg の 1 回のシステムコールでまとめて送受信するメッセージの最大数
+const uint32_t SEND_MMSG_NUM = 32;
+const uint32_t RECV_MMSG_NUM = 32;
+
+// RWer のメッセージをシーケンス番号 + ACK + 再送で確実に届けるか
+bool RELIABLE_UDP_FLAG = true;
+
+// 送信先ごとの ACK 待ちメッセージ数の上限 (64 の倍数). これを超えると送信スレッドは ACK を待つ
+const uint32_t RELIABLE_WINDOW_SIZE = 1024;
+
+// ACK が返ってこないメッセージを再送するまでの時間 (ms), 再送スレッドの確認間隔 (ms)
+const uint32_t RETRANSMIT_TIMEOUT_MS = 50;
+const uint32_t RETRANSMIT_CHECK_INTERVAL_MS = 10;
+
+// 終了検出で待つ時間の上限 (s). これを過ぎたら StartManager は終了の合図 (END_EXP) を送って結果を集める
+const uint32_t TERMINATION_TIMEOUT_SEC = 600;
+
+// walkEngine スレッドが 1 回に自分のキューから取り出して実行する RWer の最大数 (残りは他のスレッドが盗めるようにキューに残す)
+const uint32_t PROC_MESSAGE_BATCH = 256;
+
+// 暇な walkEngine スレッドが自分のキューで眠る時間の上限 (μs). 起きるたびに他のスレッドのキューから RWer を盗みにいく
+const uint32_t STEAL_INTERVAL_US = 1000;
+
+// node2vec の RW をするか (false なら 1 次の RW). node2vec のときは歩数を NODE2VEC_WALK_LENGTH に固定する
+bool NODE2VEC_FLAG = false;
+
+// node2vec の return パラメータ p, in-out パラメータ q, 歩数
+const double NODE2VEC_P = 1.0;
+const double NODE2VEC_Q = 1.0;
+const uint16_t NODE2VEC_WALK_LENGTH = 80;
+
+// 一歩前の頂点が他サーバにあるときに RWer に持たせる隣接スケッチ (Bloom filter) の大きさ (64bit 単位) とハッシュ関数の数
+const uint32_t NODE2VEC_SKETCH_WORDS = 8;
+const uint32_t NODE2VEC_SKETCH_HASH_NUM = 3;
+
+// 終了した RWer の経路をコーパスとしてファイルに出力するか (word2vec / DeepWalk の学習用, メイン実行のみ)
+// 出力するときは経路情報が必要なので, RWer の経路を縮めずに送る
+bool CORPUS_OUTPUT_FLAG = false;
+
+// コーパスの形式 (true: 1 行 1 経路のテキスト, false: {経路長(32bit), 頂点 ID(64bit) * 経路長} のバイナリ)
+const bool CORPUS_TEXT_FLAG = true;
+
+// コーパスを分けて書くファイルの数, 1 ファイルあたりのバッファの大きさ (Byte), 書き込み待ちにできるバッファの数
+const uint32_t CORPUS_SHARD_NUM = 4;
+const uint32_t CORPUS_BUFFER_SIZE = 1 << 22;
+const uint32_t CORPUS_QUEUE_BUFFER_NUM = 16;
+
+// 終了した RWer を (起点, 終点) ごとに数えて PPR を推定するか (メイン実行のみ). 結果は ../output/ppr_<IP アドレス>.txt に書き出す
+bool PPR_AGGREGATE_FLAG = false;
+
+// PPR の推定で終点だけでなく経路上の全ての頂点を数えるか (経路情報が必要なので, RWer の経路を縮めずに送る)
+bool PPR_VISIT_ALL_FLAG = false;
+
+// PPR の推定結果として起点ごとに書き出す頂点の数 (推定値の大きい順, 0 なら全て)
+const uint32_t PPR_TOP_K = 100;
+
+// オンラインの PPR クエリ (1 つの起点からの PPR) を受け付けるか, 受け付ける TCP のポート番号
+// 受け付けるポートには認証がないので, クエリを使うとき (query クライアントを使うとき) だけ true にする
+bool QUERY_SERVER_FLAG = false;
+const uint16_t QUERY_PORT = 9998;
+
+// 1 クエリで出す RWer の数と返す頂点数の上限, 結果を待つ時間の上限 (ms, 過ぎたらそれまでに戻ってきた RWer だけで答える)
+const uint32_t QUERY_MAX_RWER_NUM = 1 << 20;
+const uint32_t QUERY_MAX_TOP_K = 1000;
+const uint32_t QUERY_TIMEOUT_MS = 1000;
+
+// cache 補充用の実行の前に, サーバをまたぐエッジが多い ghost 頂点の隣接リストを持ち主から丸ごと複製するか, 要求を受け付ける TCP のポート番号
+// 使うときは全てのサーバで true にする (持ち主側が要求を受け付けていないと複製できない)
+bool REPLICA_FLAG = false;
+const uint16_t REPLICA_PORT = 9997;
+
+// 複製する ghost 頂点の数の上限, 候補にする ghost 頂点の「自サーバの頂点からのエッジ数」の下限, 複製するエッジ数の上限 (サーバごと)
+const uint32_t REPLICA_GHOST_NUM = 1024;
+const uint32_t REPLICA_MIN_CROSSING_NUM = 2;
+const uint64_t REPLICA_MAX_EDGE_NUM = 1 << 24;
+
+// 学習したキャッシュを ../output/cache_<IP アドレス>.snapshot に書き出し, 次回の起動時に (分割全体が同じなら) 読み込んでキャッシュ生成用の RW を省くか
+// 読み込むとキャッシュ生成の時間と中身が前回の実行に依存するので, 実行時間を比べる実験では false のままにする
+bool CACHE_SNAPSHOT_FLAG = false;
\ No newline at end of file
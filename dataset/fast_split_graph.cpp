@@ -0,0 +1,451 @@
+/*
+テキストのエッジリストを, 対話なしで並列にパーティションファイルへ変換する (gconverter + split_graph の代わり)
+出力は split_graph (または partition_graph の owner.txt を渡せばその分割) と同じ
+
+使い方:
+./fast_split_graph <入力 (1 行 1 エッジ)> <出力ディレクトリ> <分割数> [オプション]
+  --undirected     元々無向グラフ (各エッジが両方向とも入力にある). 指定しなければ逆向きのエッジも追加する
+  --weighted       重み付きグラフ (各行が src dst weight)
+  --owner <file>   頂点の持ち主をファイル (partition_graph の owner.txt) から読む. 指定しなければ v % 分割数
+  --server <file>  サーバの IP アドレスの一覧 (デフォルト ../config/server.txt)
+  --threads <数>   スレッド数 (デフォルト コア数)
+  --memory <MB>    使うメモリの目安 (デフォルト 4096)
+例: ./fast_split_graph ./source_graph/karate.txt ./split_graph/karate/3/ 3
+
+処理の流れ:
+1. 入力を mmap し, 行の境目で区切ってスレッドごとに読む (# か % で始まる行はコメントとして飛ばす)
+2. 各スレッドは読んだエッジを持ち主のパーティションごとのバッファに入れ, いっぱいになったらパーティションごとの一時ファイル
+   (<出力ディレクトリ>/<IP アドレス>.bucket) に追記する. エッジリスト全体をメモリに載せないので, メモリより大きい入力でも変換できる
+3. 一時ファイルを 1 つずつ読み込んで build_partition で CSR にし, <出力ディレクトリ>/<IP アドレス>.data に書き出す
+   メモリの目安に収まる範囲で, 複数のパーティションを同時に変換する (1 つのパーティションはメモリに載る必要がある)
+*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+
+#include "../include/type.hpp"
+#include "../include/storage.hpp"
+
+using namespace std;
+
+// 変換の設定
+struct ConvertOption
+{
+    string input_path;
+    string output_dir;
+    int split_num = 0;
+    bool undirected = false;
+    bool weighted = false;
+    string owner_path;
+    string server_path = "../config/server.txt";
+    uint32_t thread_num = thread::hardware_concurrency();
+    uint64_t memory_limit = 4096ULL << 20;
+};
+
+// パーティションごとの一時ファイル (複数のスレッドが追記する)
+struct Bucket
+{
+    FILE *file = nullptr;
+    string path;
+    uint64_t edge_num = 0;
+    mutex mtx;
+};
+
+// 同時に変換するパーティションのメモリ使用量を目安以下に抑える
+class MemoryBudget
+{
+public:
+    MemoryBudget(const uint64_t &limit) : limit_(limit) {}
+
+    // 何も使っていなければ目安を超えていても確保する (1 つのパーティションが目安より大きい場合)
+    void acquire(const uint64_t &bytes)
+    {
+        unique_lock<mutex> lk(mtx_);
+        cv_.wait(lk, [&]
+                 { return used_ == 0 || used_ + bytes <= limit_; });
+        used_ += bytes;
+    }
+
+    void release(const uint64_t &bytes)
+    {
+        lock_guard<mutex> lk(mtx_);
+        used_ -= bytes;
+        cv_.notify_all();
+    }
+
+private:
+    uint64_t limit_;
+    uint64_t used_ = 0;
+    mutex mtx_;
+    condition_variable cv_;
+};
+
+// 改行以外の空白を飛ばす (行末か入力の終わりなら false)
+inline bool skipSpaces(const char *&p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p < end && *p != '\n';
+}
+
+// 次の行の先頭に進む
+inline void skipLine(const char *&p, const char *end)
+{
+    const char *nl = (const char *)memchr(p, '\n', end - p);
+    p = (nl == nullptr) ? end : nl + 1;
+}
+
+// 符号なし整数を読む
+inline bool parseVertex(const char *&p, const char *end, vertex_id_t &value)
+{
+    if (!skipSpaces(p, end) || *p < '0' || *p > '9')
+        return false;
+    vertex_id_t v = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        v = v * 10 + (*p - '0');
+        p++;
+    }
+    value = v;
+    return true;
+}
+
+// 小数 (指数表記も) を読む. 仮数を整数で読んでから 10 の冪を掛ける
+inline bool parseWeight(const char *&p, const char *end, edge_weight_t &value)
+{
+    if (!skipSpaces(p, end))
+        return false;
+    bool negative = false;
+    if (*p == '-' || *p == '+')
+    {
+        negative = (*p == '-');
+        p++;
+    }
+    uint64_t mantissa = 0;
+    int exponent = 0, digit_num = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digit_num++)
+    {
+        if (mantissa < 1000000000000000000ULL)
+            mantissa = mantissa * 10 + (*p - '0');
+        else
+            exponent++; // 有効桁を超えた分
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digit_num++)
+        {
+            if (mantissa < 1000000000000000000ULL)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+        }
+    }
+    if (digit_num == 0)
+        return false;
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        bool exp_negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            exp_negative = (*p == '-');
+            p++;
+        }
+        int e = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            e = min(e * 10 + (*p - '0'), 100000);
+        exponent += exp_negative ? -e : e;
+    }
+    double v = (double)mantissa * pow(10.0, exponent);
+    value = negative ? -v : v;
+    return true;
+}
+
+// [begin, end) の行を読み, エッジを持ち主のパーティションの一時ファイルに振り分ける
+void bucketEdges(const char *begin, const char *end, const ConvertOption &option, const unordered_map<vertex_id_t, int> &owner,
+                 vector<Bucket> &buckets, const uint64_t &buffer_edge_num, atomic<uint64_t> &edge_num, atomic<uint64_t> &skipped_num,
+                 atomic<uint64_t> &edge_hash_sum)
+{
+    vector<vector<Edge_dstIp>> buffers(option.split_num);
+    for (auto &buffer : buffers)
+        buffer.reserve(buffer_edge_num);
+
+    auto flush = [&](const int &part)
+    {
+        Bucket &bucket = buckets[part];
+        lock_guard<mutex> lk(bucket.mtx);
+        auto ret = fwrite(buffers[part].data(), sizeof(Edge_dstIp), buffers[part].size(), bucket.file);
+        if (ret != buffers[part].size())
+        {
+            perror("fwrite bucket");
+            exit(1); // 異常終了
+        }
+        bucket.edge_num += ret;
+        buffers[part].clear();
+    };
+    uint64_t local_edge_hash_sum = 0;
+    auto push = [&](const int &part, const Edge_dstIp &edge)
+    {
+        local_edge_hash_sum += partition_edge_hash(edge, part);
+        buffers[part].push_back(edge);
+        if (buffers[part].size() >= buffer_edge_num)
+            flush(part);
+    };
+    auto owner_of = [&](const vertex_id_t &v)
+    {
+        if (!owner.empty())
+        {
+            auto it = owner.find(v);
+            if (it != owner.end())
+                return it->second;
+        }
+        return (int)(v % option.split_num);
+    };
+
+    uint64_t local_edge_num = 0, local_skipped_num = 0;
+    const char *p = begin;
+    while (p < end)
+    {
+        if (!skipSpaces(p, end) || *p == '#' || *p == '%')
+        { // 空行, コメント
+            skipLine(p, end);
+            continue;
+        }
+        vertex_id_t src, dst;
+        edge_weight_t weight = 1;
+        if (!parseVertex(p, end, src) || !parseVertex(p, end, dst) || (option.weighted && !parseWeight(p, end, weight)))
+        {
+            local_skipped_num++;
+            skipLine(p, end);
+            continue;
+        }
+        skipLine(p, end);
+
+        int src_owner = owner_of(src), dst_owner = owner_of(dst);
+        push(src_owner, Edge_dstIp(src, dst, dst_owner, weight));
+        if (!option.undirected)
+            push(dst_owner, Edge_dstIp(dst, src, src_owner, weight));
+        local_edge_num++;
+    }
+
+    for (int part = 0; part < option.split_num; part++)
+    {
+        if (!buffers[part].empty())
+            flush(part);
+    }
+    edge_num += local_edge_num;
+    skipped_num += local_skipped_num;
+    edge_hash_sum += local_edge_hash_sum;
+}
+
+// path までのディレクトリを作る
+void makeDirectories(const string &path)
+{
+    for (size_t pos = path.find('/', 1); pos != string::npos; pos = path.find('/', pos + 1))
+        mkdir(path.substr(0, pos).c_str(), 0755);
+    mkdir(path.c_str(), 0755);
+}
+
+bool parseOption(int argc, char *argv[], ConvertOption &option)
+{
+    if (argc < 4)
+        return false;
+    option.input_path = argv[1];
+    option.output_dir = argv[2];
+    if (option.output_dir.back() != '/')
+        option.output_dir += "/";
+    option.split_num = atoi(argv[3]);
+    for (int i = 4; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--undirected")
+            option.undirected = true;
+        else if (arg == "--weighted")
+            option.weighted = true;
+        else if (arg == "--owner" && i + 1 < argc)
+            option.owner_path = argv[++i];
+        else if (arg == "--server" && i + 1 < argc)
+            option.server_path = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+            option.thread_num = atoi(argv[++i]);
+        else if (arg == "--memory" && i + 1 < argc)
+            option.memory_limit = strtoull(argv[++i], nullptr, 10) << 20;
+        else
+            return false;
+    }
+    option.thread_num = max<uint32_t>(option.thread_num, 1);
+    return option.split_num > 0 && option.split_num <= 256; // Edge_dstIp の dst_ip は 8bit
+}
+
+int main(int argc, char *argv[])
+{
+    ConvertOption option;
+    if (!parseOption(argc, argv, option))
+    {
+        std::cerr << "usage: " << argv[0] << " <input> <output_dir> <split_num> [--undirected] [--weighted] [--owner <file>] [--server <file>] [--threads <num>] [--memory <MB>]" << std::endl;
+        return 1;
+    }
+    auto start = chrono::steady_clock::now();
+    auto elapsed = [&]
+    { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+
+    // サーバー情報読み取り
+    vector<string> server_id;
+    FILE *f = fopen(option.server_path.c_str(), "r");
+    if (f == NULL)
+    {
+        perror("fopen server");
+        exit(1); // 異常終了
+    }
+    char ch[100];
+    while (1 == fscanf(f, "%99s", ch))
+        server_id.push_back(string(ch));
+    fclose(f);
+    assert(server_id.size() >= (size_t)option.split_num);
+
+    // 頂点の持ち主
+    unordered_map<vertex_id_t, int> owner;
+    if (!option.owner_path.empty())
+    {
+        FILE *owner_f = fopen(option.owner_path.c_str(), "r");
+        if (owner_f == NULL)
+        {
+            perror("fopen owner");
+            exit(1); // 異常終了
+        }
+        vertex_id_t v;
+        int part;
+        while (2 == fscanf(owner_f, "%lu %d", &v, &part))
+        {
+            assert(part >= 0 && part < option.split_num);
+            owner[v] = part;
+        }
+        fclose(owner_f);
+    }
+
+    // 入力を mmap
+    int fd = open(option.input_path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        perror("open input");
+        exit(1); // 異常終了
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size_t input_size = st.st_size;
+    const char *input = nullptr;
+    if (input_size > 0)
+    {
+        input = (const char *)mmap(nullptr, input_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (input == MAP_FAILED)
+        {
+            perror("mmap input");
+            exit(1); // 異常終了
+        }
+        madvise((void *)input, input_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    // パーティションごとの一時ファイル
+    makeDirectories(option.output_dir);
+    vector<Bucket> buckets(option.split_num);
+    for (int part = 0; part < option.split_num; part++)
+    {
+        buckets[part].path = option.output_dir + server_id[part] + ".bucket";
+        buckets[part].file = fopen(buckets[part].path.c_str(), "wb");
+        if (buckets[part].file == NULL)
+        {
+            perror("fopen bucket");
+            exit(1); // 異常終了
+        }
+    }
+
+    // 行の境目で区切って並列に振り分ける (バッファの合計はメモリの目安の 1/4 まで)
+    uint64_t buffer_edge_num = max<uint64_t>(1024, option.memory_limit / 4 / sizeof(Edge_dstIp) / option.thread_num / option.split_num);
+    vector<const char *> bounds(option.thread_num + 1, input + input_size);
+    bounds[0] = input;
+    for (uint32_t t = 1; t < option.thread_num; t++)
+    {
+        const char *p = max(input + input_size * t / option.thread_num, bounds[t - 1]);
+        if (p > input && p < input + input_size && p[-1] != '\n')
+            skipLine(p, input + input_size);
+        bounds[t] = p;
+    }
+    atomic<uint64_t> edge_num(0), skipped_num(0), edge_hash_sum(0);
+    {
+        vector<thread> threads;
+        for (uint32_t t = 0; t < option.thread_num; t++)
+            threads.emplace_back(bucketEdges, bounds[t], bounds[t + 1], cref(option), cref(owner), ref(buckets), cref(buffer_edge_num), ref(edge_num), ref(skipped_num), ref(edge_hash_sum));
+        for (auto &th : threads)
+            th.join();
+    }
+    if (input != nullptr)
+        munmap((void *)input, input_size);
+    for (auto &bucket : buckets)
+        fclose(bucket.file);
+    std::cout << "read " << edge_num << " edges (" << skipped_num << " lines skipped) in " << elapsed() << " s" << std::endl;
+
+    // 分割全体のチェックサム (各サーバがキャッシュのスナップショットを今の分割で作ったものか確かめるのに使う)
+    uint64_t all_edge_num = 0;
+    for (auto &bucket : buckets)
+        all_edge_num += bucket.edge_num;
+    uint64_t checksum = partitioning_checksum(edge_hash_sum, all_edge_num, option.split_num, option.weighted);
+
+    // パーティションごとに CSR にして書き出す (1 エッジあたり 振り分けたエッジ + 構築中の配列 で 64B 程度を見込む)
+    MemoryBudget budget(option.memory_limit);
+    atomic<int> next_part(0);
+    auto build = [&]
+    {
+        for (int part = next_part++; part < option.split_num; part = next_part++)
+        {
+            Bucket &bucket = buckets[part];
+            uint64_t bytes = bucket.edge_num * 64;
+            budget.acquire(bytes);
+
+            vector<Edge_dstIp> edges(bucket.edge_num);
+            FILE *bucket_f = fopen(bucket.path.c_str(), "rb");
+            if (bucket_f == NULL || fread(edges.data(), sizeof(Edge_dstIp), edges.size(), bucket_f) != edges.size())
+            {
+                perror("fread bucket");
+                exit(1); // 異常終了
+            }
+            fclose(bucket_f);
+            remove(bucket.path.c_str());
+
+            PartitionData partition;
+            build_partition(edges.data(), edges.size(), part, partition, option.weighted);
+            partition.partitioning_checksum = checksum;
+            vector<Edge_dstIp>().swap(edges);
+            string output_path = option.output_dir + server_id[part] + ".data";
+            write_partition(output_path.c_str(), partition);
+
+            budget.release(bytes);
+            std::cout << output_path << ": " << partition.owned_num << " vertices, " << partition.neighbours.size() << " edges" << std::endl;
+        }
+    };
+    {
+        vector<thread> threads;
+        for (uint32_t t = 0; t < min<uint32_t>(option.thread_num, option.split_num); t++)
+            threads.emplace_back(build);
+        for (auto &th : threads)
+            th.join();
+    }
+    std::cout << "done in " << elapsed() << " s" << std::endl;
+    return 0;
+}
@@ -14,23 +14,36 @@ int main() {
     string input_path = "./source_graph/" + str + ".txt";
     string output_path = "./converted_graph/" + str + ".data";
 
-    std::vector<Edge<EmptyData> > edges;
+    std::string weighted_ans;
+    std::cout << "重み付きグラフかどうか (各行が src dst weight) (Yes or No)" << std::endl;
+    std::cin >> weighted_ans;
 
     FILE *f = fopen(input_path.c_str(), "r");
     assert(f != NULL);
+    FILE *out_f = fopen(output_path.c_str(), "w");
+    assert(out_f != NULL);
     vertex_id_t src, dst;
-    while (2 == fscanf(f, "%lu %lu", &src, &dst))
+    if (weighted_ans == "Yes")
+    {
+        std::vector<Edge<edge_weight_t> > edges;
+        edge_weight_t weight;
+        while (3 == fscanf(f, "%lu %lu %f", &src, &dst, &weight))
+        {
+            edges.push_back(Edge<edge_weight_t>(src, dst, weight));
+        }
+        auto ret = fwrite(edges.data(), sizeof(Edge<edge_weight_t>), edges.size(), out_f);
+        assert(ret == edges.size());
+    }
+    else
     {
-        edges.push_back(Edge<EmptyData>(src, dst));
+        std::vector<Edge<EmptyData> > edges;
+        while (2 == fscanf(f, "%lu %lu", &src, &dst))
+        {
+            edges.push_back(Edge<EmptyData>(src, dst));
+        }
+        auto ret = fwrite(edges.data(), sizeof(Edge<EmptyData>), edges.size(), out_f);
+        assert(ret == edges.size());
     }
     fclose(f);
-
-    auto es = edges.data();
-    auto e_num = edges.size();
-    FILE *out_f = fopen(output_path.c_str(), "w");
-    assert(out_f != NULL);
-    auto ret = fwrite(es, sizeof(Edge<EmptyData>), e_num, out_f);
-    assert(ret == e_num);
     fclose(out_f);
-    
 }
\ No newline at end of file
@@ -0,0 +1,558 @@
+/*
+局所性を考慮したグラフ分割 (split_graph の「頂点 v の持ち主は v % split_num」の代わり)
+RW の 1 歩がサーバをまたぐかどうかはカットされたエッジで決まるので, カットを減らすように頂点の持ち主を決める
+出力するパーティションファイルは split_graph と同じ形式で, worker はそのまま読み込める (頂点の持ち主は HostID 配列に入っている)
+
+分割方法:
+mod: split_graph と同じ (v % split_num)
+ldg: Linear Deterministic Greedy. 頂点を BFS 順に流し, 隣接頂点が最も多く (空きが多いほど優先して) あるパーティションに置く
+fennel: Fennel. 隣接頂点の数から, パーティションの大きさに応じたコスト α γ |P|^(γ-1) を引いたスコアが最大のパーティションに置く
+multilevel: 重いエッジのマッチングで頂点をまとめてグラフを小さくし, 一番小さいグラフを fennel で分割してから,
+            元のグラフに戻しながら各段階で境界の頂点を (制約を守る範囲で) カットが減るパーティションに移す
+
+制約:
+各パーティションの頂点数とエッジ数 (そのパーティションに置かれる隣接リストの長さの和) がどちらも平均の (1 + ε) 倍以下になるようにする
+(どこにも入らない頂点は, 一番空いているパーティションに置く)
+
+出力:
+./split_graph/<グラフ名>/<分割数>/<サーバの IP アドレス>.data: パーティションファイル
+./split_graph/<グラフ名>/<分割数>/owner.txt: 1 行 1 頂点で "頂点 持ち主 (server.txt の何行目か)" (query クライアント用)
+./split_graph/<グラフ名>/<分割数>/partition_stats.txt: パーティションごとの頂点数, エッジ数, カットされたエッジ数 (mod で分割した場合の値も並べる)
+*/
+
+#include <assert.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <cmath>
+
+#include "../include/type.hpp"
+#include "../include/storage.hpp"
+
+using namespace std;
+
+// 入力のエッジ (1 行分)
+struct RawEdge
+{
+    vertex_id_t src;
+    vertex_id_t dst;
+    edge_weight_t weight;
+};
+
+// 分割に使う無向グラフ (頂点は 0 から詰めた ID の CSR, 粗くしたグラフでは 1 頂点が元の複数の頂点をまとめたもの)
+struct PartGraph
+{
+    vector<uint64_t> offsets;        // 頂点数 + 1
+    vector<uint32_t> neighbours;     // 隣接頂点
+    vector<uint64_t> edge_weights;   // エッジの重み (まとめた元のエッジの数)
+    vector<uint64_t> vertex_weights; // 頂点の重み (まとめた元の頂点の数)
+    vector<uint64_t> edge_loads;     // 頂点を持つパーティションに置かれる隣接リストの長さ (元の出次数の和)
+
+    uint32_t size() const { return vertex_weights.size(); }
+};
+
+// 各パーティションの頂点数とエッジ数の上限
+struct Balance
+{
+    uint64_t vertex_cap;
+    uint64_t edge_cap;
+};
+
+// 各パーティションに置いた頂点数とエッジ数
+struct PartLoad
+{
+    vector<uint64_t> vertex_load;
+    vector<uint64_t> edge_load;
+
+    PartLoad(const int &split_num) : vertex_load(split_num, 0), edge_load(split_num, 0) {}
+
+    bool fits(const int &part, const PartGraph &g, const uint32_t &v, const Balance &cap) const
+    {
+        return vertex_load[part] + g.vertex_weights[v] <= cap.vertex_cap && edge_load[part] + g.edge_loads[v] <= cap.edge_cap;
+    }
+
+    // 頂点数とエッジ数のうち, 上限に対してより埋まっている方の割合
+    double fill(const int &part, const Balance &cap) const
+    {
+        return max((double)vertex_load[part] / cap.vertex_cap, (double)edge_load[part] / cap.edge_cap);
+    }
+
+    void add(const int &part, const PartGraph &g, const uint32_t &v)
+    {
+        vertex_load[part] += g.vertex_weights[v];
+        edge_load[part] += g.edge_loads[v];
+    }
+
+    void remove(const int &part, const PartGraph &g, const uint32_t &v)
+    {
+        vertex_load[part] -= g.vertex_weights[v];
+        edge_load[part] -= g.edge_loads[v];
+    }
+};
+
+// (隣接頂点, 重み) の組から CSR を作る (同じ隣接頂点はまとめて重みを足す, 自己ループは除く)
+void buildAdjacency(const uint32_t &n, vector<pair<uint32_t, pair<uint32_t, uint64_t>>> &arcs, PartGraph &g)
+{
+    sort(arcs.begin(), arcs.end());
+    g.offsets.assign(n + 1, 0);
+    g.neighbours.clear();
+    g.edge_weights.clear();
+    for (size_t i = 0; i < arcs.size(); i++)
+    {
+        uint32_t u = arcs[i].first, v = arcs[i].second.first;
+        if (u == v)
+            continue;
+        if (g.offsets[u + 1] > 0 && g.neighbours.back() == v)
+        { // u の隣接リストの直前と同じ頂点
+            g.edge_weights.back() += arcs[i].second.second;
+            continue;
+        }
+        g.neighbours.push_back(v);
+        g.edge_weights.push_back(arcs[i].second.second);
+        g.offsets[u + 1]++;
+    }
+    for (uint32_t u = 0; u < n; u++)
+        g.offsets[u + 1] += g.offsets[u];
+}
+
+// 頂点を BFS 順に並べる (連結成分ごとに, 頂点 ID の小さい頂点から始める)
+vector<uint32_t> bfsOrder(const PartGraph &g)
+{
+    uint32_t n = g.size();
+    vector<uint32_t> order;
+    order.reserve(n);
+    vector<bool> visited(n, false);
+    for (uint32_t root = 0; root < n; root++)
+    {
+        if (visited[root])
+            continue;
+        visited[root] = true;
+        size_t head = order.size();
+        order.push_back(root);
+        while (head < order.size())
+        {
+            uint32_t u = order[head++];
+            for (uint64_t e = g.offsets[u]; e < g.offsets[u + 1]; e++)
+            {
+                uint32_t v = g.neighbours[e];
+                if (!visited[v])
+                {
+                    visited[v] = true;
+                    order.push_back(v);
+                }
+            }
+        }
+    }
+    return order;
+}
+
+// 頂点を BFS 順に 1 つずつ流して持ち主を決める (LDG か Fennel)
+vector<int> streamPartition(const PartGraph &g, const int &split_num, const bool &fennel, const Balance &cap)
+{
+    uint32_t n = g.size();
+    vector<int> owner(n, -1);
+    PartLoad load(split_num);
+
+    // Fennel のコスト α γ |P|^(γ-1) (γ = 1.5, α = sqrt(k) m / n^1.5)
+    const double gamma = 1.5;
+    double total_vertex = accumulate(g.vertex_weights.begin(), g.vertex_weights.end(), 0.0);
+    double total_edge = accumulate(g.edge_weights.begin(), g.edge_weights.end(), 0.0) / 2;
+    double alpha = sqrt((double)split_num) * total_edge / pow(max(total_vertex, 1.0), gamma);
+
+    vector<uint64_t> conn(split_num, 0); // パーティションごとの, 既に置いた隣接頂点へのエッジの重み
+    for (uint32_t v : bfsOrder(g))
+    {
+        fill(conn.begin(), conn.end(), 0);
+        for (uint64_t e = g.offsets[v]; e < g.offsets[v + 1]; e++)
+        {
+            int part = owner[g.neighbours[e]];
+            if (part >= 0)
+                conn[part] += g.edge_weights[e];
+        }
+
+        int best = -1;
+        double best_score = 0;
+        for (int part = 0; part < split_num; part++)
+        {
+            if (!load.fits(part, g, v, cap))
+                continue;
+
+            double score;
+            if (fennel)
+                score = conn[part] - alpha * gamma * pow((double)load.vertex_load[part], gamma - 1) * g.vertex_weights[v];
+            else
+                score = conn[part] * (1 - load.fill(part, cap));
+
+            // スコアが同じなら空いている方
+            if (best < 0 || score > best_score || (score == best_score && load.fill(part, cap) < load.fill(best, cap)))
+            {
+                best = part;
+                best_score = score;
+            }
+        }
+
+        if (best < 0)
+        { // どこにも入らないので一番空いているパーティションに置く
+            best = 0;
+            for (int part = 1; part < split_num; part++)
+            {
+                if (load.fill(part, cap) < load.fill(best, cap))
+                    best = part;
+            }
+        }
+
+        owner[v] = best;
+        load.add(best, g, v);
+    }
+    return owner;
+}
+
+// 重いエッジでマッチングした頂点の組をまとめて粗いグラフを作る (coarse_id[v] は v をまとめた頂点)
+void coarsen(const PartGraph &g, const uint64_t &max_vertex_weight, mt19937_64 &gen, vector<uint32_t> &coarse_id, PartGraph &coarse)
+{
+    uint32_t n = g.size();
+    vector<uint32_t> order(n);
+    iota(order.begin(), order.end(), 0);
+    shuffle(order.begin(), order.end(), gen);
+
+    const uint32_t UNMATCHED = UINT32_MAX;
+    vector<uint32_t> match(n, UNMATCHED);
+    for (uint32_t u : order)
+    {
+        if (match[u] != UNMATCHED)
+            continue;
+        uint32_t best = u;
+        uint64_t best_weight = 0;
+        for (uint64_t e = g.offsets[u]; e < g.offsets[u + 1]; e++)
+        {
+            uint32_t v = g.neighbours[e];
+            if (match[v] == UNMATCHED && g.edge_weights[e] > best_weight && g.vertex_weights[u] + g.vertex_weights[v] <= max_vertex_weight)
+            {
+                best = v;
+                best_weight = g.edge_weights[e];
+            }
+        }
+        match[u] = best;
+        match[best] = u;
+    }
+
+    // まとめた頂点に ID を振る
+    coarse_id.assign(n, UNMATCHED);
+    uint32_t coarse_n = 0;
+    for (uint32_t u = 0; u < n; u++)
+    {
+        if (coarse_id[u] == UNMATCHED)
+        {
+            coarse_id[u] = coarse_id[match[u]] = coarse_n++;
+        }
+    }
+
+    coarse.vertex_weights.assign(coarse_n, 0);
+    coarse.edge_loads.assign(coarse_n, 0);
+    vector<pair<uint32_t, pair<uint32_t, uint64_t>>> arcs;
+    arcs.reserve(g.neighbours.size());
+    for (uint32_t u = 0; u < n; u++)
+    {
+        uint32_t cu = coarse_id[u];
+        coarse.vertex_weights[cu] += g.vertex_weights[u];
+        coarse.edge_loads[cu] += g.edge_loads[u];
+        for (uint64_t e = g.offsets[u]; e < g.offsets[u + 1]; e++)
+            arcs.push_back({cu, {coarse_id[g.neighbours[e]], g.edge_weights[e]}});
+    }
+    buildAdjacency(coarse_n, arcs, coarse);
+}
+
+// 境界の頂点を, 制約を守る範囲でカットが減るパーティションに移す (移す頂点がなくなるか passes 回まで)
+void refine(const PartGraph &g, const int &split_num, const Balance &cap, const int &passes, vector<int> &owner)
+{
+    uint32_t n = g.size();
+    PartLoad load(split_num);
+    for (uint32_t v = 0; v < n; v++)
+        load.add(owner[v], g, v);
+
+    vector<uint64_t> conn(split_num, 0);
+    vector<int> touched;
+    for (int pass = 0; pass < passes; pass++)
+    {
+        uint64_t moved = 0;
+        for (uint32_t v = 0; v < n; v++)
+        {
+            int own = owner[v];
+            for (uint64_t e = g.offsets[v]; e < g.offsets[v + 1]; e++)
+            {
+                int part = owner[g.neighbours[e]];
+                if (conn[part] == 0)
+                    touched.push_back(part);
+                conn[part] += g.edge_weights[e];
+            }
+
+            int best = own;
+            int64_t best_gain = 0;
+            for (int part : touched)
+            {
+                int64_t gain = (int64_t)conn[part] - (int64_t)conn[own];
+                if (part != own && gain > best_gain && load.fits(part, g, v, cap))
+                {
+                    best = part;
+                    best_gain = gain;
+                }
+            }
+            for (int part : touched)
+                conn[part] = 0;
+            touched.clear();
+
+            if (best != own)
+            {
+                load.remove(own, g, v);
+                load.add(best, g, v);
+                owner[v] = best;
+                moved++;
+            }
+        }
+        if (moved == 0)
+            break;
+    }
+}
+
+// 多段階分割: 粗くしてから fennel で分割し, 戻しながら改善する
+vector<int> multilevelPartition(const PartGraph &g, const int &split_num, const Balance &cap)
+{
+    const uint32_t COARSEST_SIZE = max(1024, 64 * split_num); // これ以下まで粗くする
+    const int REFINE_PASSES = 8;
+    mt19937_64 gen(1);
+
+    vector<PartGraph> levels;
+    vector<vector<uint32_t>> coarse_ids;
+    const PartGraph *current = &g;
+    while (current->size() > COARSEST_SIZE && levels.size() < 32)
+    {
+        // 1 つの頂点が 1 パーティションの上限の 1/4 を超えないようにまとめる
+        vector<uint32_t> coarse_id;
+        PartGraph coarse;
+        coarsen(*current, cap.vertex_cap / 4, gen, coarse_id, coarse);
+        if (coarse.size() > current->size() * 0.95)
+            break; // ほとんど小さくならない
+        std::cout << "coarsen: " << current->size() << " -> " << coarse.size() << std::endl;
+        levels.push_back(move(coarse));
+        coarse_ids.push_back(move(coarse_id));
+        current = &levels.back();
+    }
+
+    vector<int> owner = streamPartition(*current, split_num, true, cap);
+    refine(*current, split_num, cap, REFINE_PASSES, owner);
+
+    // 細かいグラフに戻しながら改善する
+    for (int level = (int)levels.size() - 1; level >= 0; level--)
+    {
+        const PartGraph &fine = (level == 0) ? g : levels[level - 1];
+        vector<int> fine_owner(fine.size());
+        for (uint32_t v = 0; v < fine.size(); v++)
+            fine_owner[v] = owner[coarse_ids[level][v]];
+        owner.swap(fine_owner);
+        refine(fine, split_num, cap, REFINE_PASSES, owner);
+    }
+    return owner;
+}
+
+// パーティションごとの頂点数, エッジ数, カットされたエッジ数を書き出す
+void writeStats(FILE *out, const string &title, const vector<RawEdge> &raw_edges, const vector<vertex_id_t> &ids, const vector<int> &owner, const int &split_num, const bool &undirected)
+{
+    vector<uint64_t> vertex_num(split_num, 0), edge_num(split_num, 0), cut_num(split_num, 0);
+    for (size_t i = 0; i < ids.size(); i++)
+        vertex_num[owner[i]]++;
+
+    auto count_edge = [&](const vertex_id_t &src, const vertex_id_t &dst)
+    {
+        int src_owner = owner[lower_bound(ids.begin(), ids.end(), src) - ids.begin()];
+        int dst_owner = owner[lower_bound(ids.begin(), ids.end(), dst) - ids.begin()];
+        edge_num[src_owner]++;
+        if (src_owner != dst_owner)
+            cut_num[src_owner]++;
+    };
+    for (const RawEdge &e : raw_edges)
+    {
+        count_edge(e.src, e.dst);
+        if (!undirected)
+            count_edge(e.dst, e.src);
+    }
+
+    uint64_t all_vertex = ids.size(), all_edge = 0, all_cut = 0, max_vertex = 0, max_edge = 0;
+    fprintf(out, "# %s\n# partition vertices edges cut_edges cut_ratio\n", title.c_str());
+    for (int i = 0; i < split_num; i++)
+    {
+        fprintf(out, "%d %lu %lu %lu %.4f\n", i, vertex_num[i], edge_num[i], cut_num[i], edge_num[i] == 0 ? 0.0 : (double)cut_num[i] / edge_num[i]);
+        all_edge += edge_num[i];
+        all_cut += cut_num[i];
+        max_vertex = max(max_vertex, vertex_num[i]);
+        max_edge = max(max_edge, edge_num[i]);
+    }
+    fprintf(out, "# total: vertices %lu, edges %lu, cut_edges %lu, cut_ratio %.4f, vertex_imbalance %.3f, edge_imbalance %.3f\n\n",
+            all_vertex, all_edge, all_cut, all_edge == 0 ? 0.0 : (double)all_cut / all_edge,
+            all_vertex == 0 ? 0.0 : (double)max_vertex * split_num / all_vertex, all_edge == 0 ? 0.0 : (double)max_edge * split_num / all_edge);
+}
+
+int main()
+{
+    std::string str;
+    std::cout << "filename" << std::endl;
+    std::cin >> str;
+    int split_num = 0;
+    std::cout << "split_num" << std::endl;
+    std::cin >> split_num;
+    std::string ans;
+    std::cout << "元々無向グラフかどうか(Yes or No)" << std::endl;
+    cin >> ans;
+    bool undirected = (ans == "Yes");
+    std::string weighted_ans;
+    std::cout << "重み付きグラフかどうか (各行が src dst weight) (Yes or No)" << std::endl;
+    cin >> weighted_ans;
+    bool weighted = (weighted_ans == "Yes");
+    std::string method;
+    std::cout << "分割方法 (mod, ldg, fennel, multilevel)" << std::endl;
+    cin >> method;
+    double epsilon = 0;
+    std::cout << "許容する偏り ε (各パーティションの頂点数・エッジ数を平均の 1 + ε 倍まで許す, 例: 0.05)" << std::endl;
+    cin >> epsilon;
+    assert(split_num > 0 && split_num <= 256); // Edge_dstIp の dst_ip は 8bit
+
+    string input_path = "./source_graph/" + str + ".txt";
+    string output_dir = "./split_graph/" + str + "/" + to_string(split_num) + "/";
+
+    // サーバー情報読み取り
+    vector<string> server_id;
+    FILE *f = fopen("../config/server.txt", "r");
+    assert(f != NULL);
+    char ch[100];
+    while (1 == fscanf(f, "%s", ch))
+    {
+        string str(ch);
+        server_id.push_back(str);
+    }
+    fclose(f);
+    assert(server_id.size() >= (size_t)split_num);
+
+    // エッジ読み取り
+    vector<RawEdge> raw_edges;
+    FILE *in_f = fopen(input_path.c_str(), "r");
+    assert(in_f != NULL);
+    vertex_id_t src, dst;
+    edge_weight_t weight = 1;
+    while (2 == fscanf(in_f, "%lu %lu", &src, &dst) && (!weighted || 1 == fscanf(in_f, "%f", &weight)))
+    {
+        raw_edges.push_back({src, dst, weight});
+    }
+    fclose(in_f);
+
+    // 頂点 ID を 0 から詰める
+    vector<vertex_id_t> ids;
+    ids.reserve(raw_edges.size() * 2);
+    for (const RawEdge &e : raw_edges)
+    {
+        ids.push_back(e.src);
+        ids.push_back(e.dst);
+    }
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+    auto dense_id = [&](const vertex_id_t &v)
+    { return (uint32_t)(lower_bound(ids.begin(), ids.end(), v) - ids.begin()); };
+    uint32_t n = ids.size();
+    std::cout << "vertices: " << n << ", edges: " << raw_edges.size() << std::endl;
+
+    // 分割に使う無向グラフ (エッジ数の制約は各頂点の隣接リストの長さで数える)
+    PartGraph g;
+    g.vertex_weights.assign(n, 1);
+    g.edge_loads.assign(n, 0);
+    {
+        vector<pair<uint32_t, pair<uint32_t, uint64_t>>> arcs;
+        arcs.reserve(raw_edges.size() * 2);
+        for (const RawEdge &e : raw_edges)
+        {
+            uint32_t u = dense_id(e.src), v = dense_id(e.dst);
+            arcs.push_back({u, {v, 1}});
+            arcs.push_back({v, {u, 1}});
+            g.edge_loads[u]++;
+            if (!undirected)
+                g.edge_loads[v]++;
+        }
+        buildAdjacency(n, arcs, g);
+    }
+
+    Balance cap;
+    uint64_t total_edge_load = accumulate(g.edge_loads.begin(), g.edge_loads.end(), (uint64_t)0);
+    cap.vertex_cap = max<uint64_t>(1, ceil((1 + epsilon) * n / split_num));
+    cap.edge_cap = max<uint64_t>(1, ceil((1 + epsilon) * total_edge_load / split_num));
+
+    // 頂点の持ち主を決める
+    vector<int> mod_owner(n);
+    for (uint32_t v = 0; v < n; v++)
+        mod_owner[v] = ids[v] % split_num;
+
+    vector<int> owner;
+    if (method == "mod")
+        owner = mod_owner;
+    else if (method == "ldg")
+        owner = streamPartition(g, split_num, false, cap);
+    else if (method == "fennel")
+        owner = streamPartition(g, split_num, true, cap);
+    else if (method == "multilevel")
+        owner = multilevelPartition(g, split_num, cap);
+    else
+    {
+        std::cerr << "unknown method: " << method << std::endl;
+        return 1;
+    }
+
+    // パーティションごとのエッジ (split_graph と同じ並び)
+    vector<vector<Edge_dstIp>> edges(split_num);
+    for (const RawEdge &e : raw_edges)
+    {
+        int src_owner = owner[dense_id(e.src)], dst_owner = owner[dense_id(e.dst)];
+        edges[src_owner].push_back(Edge_dstIp(e.src, e.dst, dst_owner, e.weight));
+        if (!undirected)
+            edges[dst_owner].push_back(Edge_dstIp(e.dst, e.src, src_owner, e.weight));
+    }
+
+    // 分割全体のチェックサム (各サーバがキャッシュのスナップショットを今の分割で作ったものか確かめるのに使う)
+    uint64_t edge_hash_sum = 0, all_edge_num = 0;
+    for (int i = 0; i < split_num; i++)
+    {
+        for (const Edge_dstIp &e : edges[i])
+            edge_hash_sum += partition_edge_hash(e, i);
+        all_edge_num += edges[i].size();
+    }
+    uint64_t checksum = partitioning_checksum(edge_hash_sum, all_edge_num, split_num, weighted);
+
+    // CSR 形式のパーティションファイルとして書き出す (重み付きなら重み配列も)
+    for (int i = 0; i < split_num; i++)
+    {
+        PartitionData partition;
+        build_partition(edges[i].data(), edges[i].size(), i, partition, weighted);
+        partition.partitioning_checksum = checksum;
+        vector<Edge_dstIp>().swap(edges[i]);
+        string output_path = output_dir + server_id[i] + ".data";
+        write_partition(output_path.c_str(), partition);
+    }
+
+    // 頂点の持ち主
+    FILE *owner_f = fopen((output_dir + "owner.txt").c_str(), "w");
+    assert(owner_f != NULL);
+    for (uint32_t v = 0; v < n; v++)
+        fprintf(owner_f, "%lu %d\n", ids[v], owner[v]);
+    fclose(owner_f);
+
+    // カットの統計 (mod で分割した場合と並べる)
+    FILE *stats_f = fopen((output_dir + "partition_stats.txt").c_str(), "w");
+    assert(stats_f != NULL);
+    writeStats(stats_f, method, raw_edges, ids, owner, split_num, undirected);
+    if (method != "mod")
+        writeStats(stats_f, "mod (reference)", raw_edges, ids, mod_owner, split_num, undirected);
+    fclose(stats_f);
+    writeStats(stdout, method, raw_edges, ids, owner, split_num, undirected);
+    if (method != "mod")
+        writeStats(stdout, "mod (reference)", raw_edges, ids, mod_owner, split_num, undirected);
+
+    return 0;
+}
@@ -18,6 +18,10 @@ int main() {
     std::string ans;
     std::cout << "元々無向グラフかどうか(Yes or No)" << std::endl;
     cin >> ans;
+    std::string weighted_ans;
+    std::cout << "重み付きグラフかどうか (各行が src dst weight) (Yes or No)" << std::endl;
+    cin >> weighted_ans;
+    bool weighted = (weighted_ans == "Yes");
 
     string input_path = "./source_graph/" + str + ".txt";
 
@@ -41,27 +45,37 @@ int main() {
     FILE *in_f = fopen(input_path.c_str(), "r");
     assert(in_f != NULL);
     vertex_id_t src, dst;
-    while (2 == fscanf(in_f, "%lu %lu", &src, &dst))
+    edge_weight_t weight = 1;
+    while (2 == fscanf(in_f, "%lu %lu", &src, &dst) && (!weighted || 1 == fscanf(in_f, "%f", &weight)))
     {
         if (ans == "Yes") {
             // cout << src%split_num << " " << src << " " << dst << " " << dst%split_num << endl;
-            edges[src%split_num].push_back(Edge_dstIp(src, dst, dst%split_num));
+            edges[src%split_num].push_back(Edge_dstIp(src, dst, dst%split_num, weight));
         } else {
-            edges[src%split_num].push_back(Edge_dstIp(src, dst, dst%split_num));
-            edges[dst%split_num].push_back(Edge_dstIp(dst, src, src%split_num));
+            edges[src%split_num].push_back(Edge_dstIp(src, dst, dst%split_num, weight));
+            edges[dst%split_num].push_back(Edge_dstIp(dst, src, src%split_num, weight));
         }
     }
     fclose(in_f);
 
+    // 分割全体のチェックサム (各サーバがキャッシュのスナップショットを今の分割で作ったものか確かめるのに使う)
+    uint64_t edge_hash_sum = 0, all_edge_num = 0;
+    for (int i = 0; i < split_num; i++)
+    {
+        for (const Edge_dstIp &e : edges[i])
+            edge_hash_sum += partition_edge_hash(e, i);
+        all_edge_num += edges[i].size();
+    }
+    uint64_t checksum = partitioning_checksum(edge_hash_sum, all_edge_num, split_num, weighted);
+
+    // CSR 形式のパーティションファイルとして書き出す (重み付きなら重み配列も)
     for (int i = 0; i < split_num; i++) {
-        auto es = edges[i].data();
-        auto e_num = edges[i].size();
+        PartitionData partition;
+        build_partition(edges[i].data(), edges[i].size(), i, partition, weighted);
+        partition.partitioning_checksum = checksum;
+        vector<Edge_dstIp>().swap(edges[i]);
         string output_path = "./split_graph/" + str + "/" + to_string(split_num) + "/" + server_id[i] + ".data";
-        FILE *out_f = fopen(output_path.c_str(), "w");
-        assert(out_f != NULL);
-        auto ret = fwrite(es, sizeof(Edge_dstIp), e_num, out_f);
-        assert(ret == e_num);
-        fclose(out_f);
+        write_partition(output_path.c_str(), partition);
     }
 
     // // test
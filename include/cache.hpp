@@ -5,10 +5,14 @@ Cache クラスを定義しており、頂点の次数情報やホストID、隣
 init メソッド:
 キャッシュの内部データ構造を初期化します。
 次数情報、ホストID情報、頂点の存在フラグ、隣接リスト
+ghost 頂点 (自サーバの頂点に隣接する他サーバの頂点) は Graph のローカル ID で引ける配列に保存し,
+それ以外の頂点 (経路情報で初めて知った頂点) は unordered_map に保存します。
+配列の大きさはパーティションの ghost 頂点数で決まります。
 
 addRWer メソッド:
 RandomWalker の経路情報からグラフデータをキャッシュとして保存します。
 経路情報を取得し、その情報を基にエッジをキャッシュに追加します。
+隣接リストのキャッシュが満杯なら, 最近使われていないエッジを追い出して入れ替えます (CACHE_EVICTION_FLAG)。
 
 addEdge メソッド:
 指定されたパス情報からエッジをキャッシュに登録します
@@ -17,11 +21,36 @@ addEdge メソッド:
 registerDegree メソッド:
 指定されたノードIDの次数情報をキャッシュに登録しす。
 次数情報が登録されたことを示すフラグも設定します。
+
+getHotGhosts / registerReplica メソッド:
+自サーバの頂点からのエッジ (サーバをまたぐエッジ) が多い ghost 頂点を選び, 持ち主から取ってきた隣接リストを丸ごと登録します。
+登録した頂点は次数と全ての index が自サーバで引けるので, その頂点にいる RWer は送信せずに進めます。
+隣接リストは登録し終わってから公開するので, 読み出しはロックを取りません。
+
+saveSnapshot / loadSnapshot メソッド:
+学習したキャッシュ (ghost 頂点の次数, それ以外の頂点の次数と HostID, (頂点, index) -> 隣接頂点) をファイルに書き出し, 次回の起動時に読み込みます。
+ファイルは先頭から ヘッダ, ghost 頂点の次数配列, それ以外の頂点の配列, 隣接リストのエントリ配列 の順に並び, 各セクションは 8 byte 境界に置きます。
+ヘッダには Graph::getChecksum (自サーバのパーティションと分割全体のチェックサム) を入れ, 読み込むときに今の値と一致しなければ (グラフや, 他サーバも含めた分割が変わっていれば) 使いません。
+読み込みは mmap した領域から直接登録します。書き出しは一時ファイルに書いてから rename するので, 途中で止まっても前のスナップショットは壊れません。
+複製した隣接リスト (registerReplica) はスナップショットに含めません (起動時に持ち主から取り直す)。
 */
 
 #pragma once
 
 #include <vector>
+#include <memory>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "type.hpp"
 #include "../config/param.hpp"
@@ -33,11 +62,50 @@ registerDegree メソッド:
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
+// ghost 以外の頂点に関するキャッシュ情報
+struct CacheVertex
+{
+    index_t degree = 0;
+    host_id_t host_id = INF;
+    bool has_degree = false;
+};
+
+// キャッシュのスナップショットファイルの識別子とバージョン
+const uint64_t CACHE_SNAPSHOT_MAGIC = 0x3143574452574452; // "RDWRDWC1"
+const uint32_t CACHE_SNAPSHOT_VERSION = 1;
+
+// スナップショットで次数が未登録であることを表す値
+const index_t CACHE_SNAPSHOT_NO_DEGREE = UINT64_MAX;
+
+// キャッシュのスナップショットファイルのヘッダ (72 byte)
+struct CacheSnapshotHeader
+{
+    uint64_t magic;              // CACHE_SNAPSHOT_MAGIC
+    uint32_t version;            // CACHE_SNAPSHOT_VERSION
+    uint32_t reserved;           // 予備
+    uint64_t partition_checksum; // 書き出したときのパーティションのチェックサム
+    uint64_t ghost_num;          // ghost 頂点数
+    uint64_t other_num;          // ghost 以外の頂点数
+    uint64_t entry_num;          // 隣接リストのエントリ数
+    uint64_t ghost_pos;          // ghost 頂点の次数配列の位置 (byte)
+    uint64_t other_pos;          // ghost 以外の頂点の配列の位置 (byte)
+    uint64_t entry_pos;          // エントリ配列の位置 (byte)
+};
+
+// スナップショットに書き出す ghost 以外の頂点 (24 byte)
+struct CacheSnapshotVertex
+{
+    vertex_id_t node_id;
+    index_t degree; // 未登録なら CACHE_SNAPSHOT_NO_DEGREE
+    host_id_t host_id;
+    uint32_t reserved;
+};
+
 class Cache
 {
 
 public:
-    void init();
+    void init(Graph &graph);
 
     // 頂点に対するキャッシュの次数情報を入手
     index_t getDegree(const vertex_id_t &node_id);
@@ -54,7 +122,7 @@ public:
     vertex_id_t getNextNodeID(const vertex_id_t &node_id, const index_t &index_num);
 
     // RWer の経路情報からグラフデータをキャッシュとして保存
-    void addRWer(std::unique_ptr<RandomWalker> &&RWer_ptr, Graph &graph);
+    void addRWer(RandomWalker &RWer, Graph &graph);
 
     // エッジをキャッシュに登録
     void addEdge(const std::vector<vertex_id_t> &path, const index_t &node_u_idx, const index_t &node_v_idx, Graph &graph);
@@ -71,56 +139,125 @@ public:
     // キャッシュのエッジカウント
     edge_id_t getEdgeCount();
 
+    // 隣接リストのキャッシュから追い出したエッジ数
+    uint64_t getEvictedEdgeCount();
+
+    // 自サーバの頂点からのエッジが多い ghost 頂点を多い順に max_num 個まで入手 (隣接リストを丸ごと複製する候補)
+    void getHotGhosts(const uint32_t &max_num, std::vector<vertex_id_t> &node_ids);
+
+    // ghost 頂点の隣接リストを丸ごと登録 (neighbours[i], host_ids[i] は index i の隣接頂点とその持ち主)
+    void registerReplica(const vertex_id_t &node_id, const std::vector<vertex_id_t> &neighbours, const std::vector<host_id_t> &host_ids);
+
+    // 隣接リストを丸ごと登録した頂点数, エッジ数
+    uint64_t getReplicaVertexCount();
+    edge_id_t getReplicaEdgeCount();
+
+    // キャッシュをスナップショットファイルに書き出す (失敗したら false)
+    bool saveSnapshot(const std::string &path, const uint64_t &partition_checksum);
+
+    // スナップショットファイルを読み込んでキャッシュに登録する (ファイルがない, 壊れている, パーティションが違うときは何もせず false)
+    bool loadSnapshot(const std::string &path, const uint64_t &partition_checksum);
+
 private:
+    // ghost 頂点なら ghost 配列の位置, そうでなければ INF
+    local_id_t getGhostIndex(const vertex_id_t &node_id);
+
     // キャッシュ情報
-    std::vector<index_t> degree_;    // 他サーバが持ち主となるノードの次数
-    std::vector<host_id_t> host_id_; // 持ち主が他サーバの頂点に関する, 持ち主のホストID {ノード ID : ホストID (ノードの持ち主)}
+    Graph *graph_ = nullptr;
+    local_id_t ghost_offset_ = 0;  // ghost 頂点の先頭ローカル ID (自サーバの頂点数)
+    std::vector<index_t> degree_;  // ghost 頂点の次数 (ghost 頂点の持ち主のホストID は Graph が持っている)
+    std::vector<uint8_t> has_v_;   // ghost 頂点の次数が登録済みか
+    std::unordered_map<vertex_id_t, CacheVertex> other_vertices_; // ghost 以外の頂点 {ノード ID : キャッシュ情報}
+    std::shared_mutex mtx_other_vertices_;
     SimpleCache adjacency_list_;
-    std::vector<bool> has_v_;
+
+    // 隣接リストを丸ごと複製した ghost 頂点 (ghost 配列の位置ごと, なければ nullptr)
+    std::unique_ptr<std::atomic<const vertex_id_t *>[]> replicas_;
+    std::vector<std::unique_ptr<vertex_id_t[]>> replica_storage_;
+    std::mutex mtx_replica_;
+    std::atomic<uint64_t> replica_vertex_num_ = 0;
+    std::atomic<edge_id_t> replica_edge_num_ = 0;
 };
 
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
-inline void Cache::init()
+inline void Cache::init(Graph &graph)
 {
-    degree_.resize(VERTEX_SIZE);
-    host_id_.resize(VERTEX_SIZE);
-    has_v_.resize(VERTEX_SIZE);
+    graph_ = &graph;
+    ghost_offset_ = graph.getMyVerticesNum();
+    degree_.resize(graph.getGhostVerticesNum());
+    has_v_.resize(graph.getGhostVerticesNum());
+    replicas_.reset(new std::atomic<const vertex_id_t *>[graph.getGhostVerticesNum()]());
     adjacency_list_.init();
 }
 
+inline local_id_t Cache::getGhostIndex(const vertex_id_t &node_id)
+{
+    local_id_t local_id = graph_->getLocalId(node_id);
+    if (local_id == INF || local_id < ghost_offset_)
+        return INF;
+    return local_id - ghost_offset_;
+}
+
 // ノードの次数情報を返す
 inline index_t Cache::getDegree(const vertex_id_t &node_id)
 {
-    return degree_[node_id];
+    local_id_t ghost_idx = getGhostIndex(node_id);
+    if (ghost_idx != INF)
+        return degree_[ghost_idx];
+
+    std::shared_lock<std::shared_mutex> lock(mtx_other_vertices_);
+    auto it = other_vertices_.find(node_id);
+    return it == other_vertices_.end() ? 0 : it->second.degree;
 }
 
 inline host_id_t Cache::getHostId(const vertex_id_t &node_id)
 {
-    return host_id_[node_id];
+    local_id_t ghost_idx = getGhostIndex(node_id);
+    if (ghost_idx != INF)
+        return graph_->getHostIdOfLocal(ghost_offset_ + ghost_idx);
+
+    std::shared_lock<std::shared_mutex> lock(mtx_other_vertices_);
+    auto it = other_vertices_.find(node_id);
+    return it == other_vertices_.end() ? INF : it->second.host_id;
 }
 
 // 指定されたノードIDの次数情報がキャッシュに存在するか
 inline bool Cache::hasDegree(const vertex_id_t &node_id)
 {
-    return has_v_[node_id];
+    local_id_t ghost_idx = getGhostIndex(node_id);
+    if (ghost_idx != INF)
+        return has_v_[ghost_idx];
+
+    std::shared_lock<std::shared_mutex> lock(mtx_other_vertices_);
+    auto it = other_vertices_.find(node_id);
+    return it != other_vertices_.end() && it->second.has_degree;
 }
 
 inline vertex_id_t Cache::getNextNodeID(const vertex_id_t &node_id, const index_t &index_num)
 {
+    // 隣接リストを丸ごと複製した頂点なら必ず見つかる
+    local_id_t ghost_idx = getGhostIndex(node_id);
+    if (ghost_idx != INF)
+    {
+        const vertex_id_t *replica = replicas_[ghost_idx].load(std::memory_order_acquire);
+        if (replica != nullptr)
+            return replica[index_num];
+    }
+
     return adjacency_list_.getNextNodeID(node_id, index_num);
 }
 
-inline void Cache::addRWer(std::unique_ptr<RandomWalker> &&RWer_ptr, Graph &graph)
+inline void Cache::addRWer(RandomWalker &RWer, Graph &graph)
 {
     // debug
     // std::cout << "addRWer" << std::endl;
 
     uint16_t path_length = 0;
     std::vector<uint64_t> path; // path: (頂点, ホストID, 次数, indexuv, indexvu), (), (), ...
-    RWer_ptr->getPath(path_length, path);
+    RWer.getPath(path_length, path);
 
     // debug
     // std::cout << "path_length: " << path_length << std::endl;
@@ -144,8 +281,8 @@ inline void Cache::addEdge(const std::vector<vertex_id_t> &path, const index_t &
     // debug
     // std::cout << "AddEdge" << std::endl;
 
-    uint32_t node_id_u = path[node_u_idx];
-    uint32_t node_id_v = path[node_v_idx];
+    vertex_id_t node_id_u = path[node_u_idx];
+    vertex_id_t node_id_v = path[node_v_idx];
     uint32_t host_id_u = path[node_u_idx + 1];
     uint32_t host_id_v = path[node_v_idx + 1];
     uint32_t degree_u = path[node_u_idx + 2];
@@ -153,10 +290,13 @@ inline void Cache::addEdge(const std::vector<vertex_id_t> &path, const index_t &
     uint32_t index_uv = path[node_v_idx + 3];
     uint32_t index_vu = path[node_v_idx + 4];
 
+    // 次数が INF (持ち主に着く前に終了した RWer が持つ未確定の値) や 0 のものは登録しない
+    // (0 を登録すると, その頂点に来た RWer が全てそこで終了してしまう. 次数 0 の頂点は持ち主に送れば終了する)
+
     if (!graph.hasVertex(node_id_u))
     {
         registerHostId(node_id_u, host_id_u);
-        if (degree_u != INF)
+        if (degree_u != INF && degree_u != 0)
             registerDegree(node_id_u, degree_u);
         if (index_uv != INF)
             registerIndex(node_id_u, node_id_v, index_uv);
@@ -165,7 +305,7 @@ inline void Cache::addEdge(const std::vector<vertex_id_t> &path, const index_t &
     if (!graph.hasVertex(node_id_v))
     {
         registerHostId(node_id_v, host_id_v);
-        if (degree_v != INF)
+        if (degree_v != INF && degree_v != 0)
             registerDegree(node_id_v, degree_v);
         if (index_vu != INF)
             registerIndex(node_id_v, node_id_u, index_vu);
@@ -174,13 +314,28 @@ inline void Cache::addEdge(const std::vector<vertex_id_t> &path, const index_t &
 
 inline void Cache::registerHostId(const vertex_id_t &node_id, const host_id_t &host_id)
 {
-    host_id_[node_id] = host_id;
+    // ghost 頂点の持ち主は Graph が持っているので登録不要
+    if (getGhostIndex(node_id) != INF)
+        return;
+
+    std::lock_guard<std::shared_mutex> lock(mtx_other_vertices_);
+    other_vertices_[node_id].host_id = host_id;
 }
 
 inline void Cache::registerDegree(const vertex_id_t &node_id, const index_t &degree)
 {
-    degree_[node_id] = degree;
-    has_v_[node_id] = true;
+    local_id_t ghost_idx = getGhostIndex(node_id);
+    if (ghost_idx != INF)
+    {
+        degree_[ghost_idx] = degree;
+        has_v_[ghost_idx] = true;
+        return;
+    }
+
+    std::lock_guard<std::shared_mutex> lock(mtx_other_vertices_);
+    CacheVertex &cache_vertex = other_vertices_[node_id];
+    cache_vertex.degree = degree;
+    cache_vertex.has_degree = true;
 }
 
 inline void Cache::registerIndex(const vertex_id_t &node_id_u, const vertex_id_t &node_id_v, const index_t &index_num)
@@ -191,4 +346,214 @@ inline void Cache::registerIndex(const vertex_id_t &node_id_u, const vertex_id_t
 inline edge_id_t Cache::getEdgeCount()
 {
     return adjacency_list_.getSize();
-}
\ No newline at end of file
+}
+
+inline uint64_t Cache::getEvictedEdgeCount()
+{
+    return adjacency_list_.getEvictedNum();
+}
+
+inline void Cache::getHotGhosts(const uint32_t &max_num, std::vector<vertex_id_t> &node_ids)
+{
+    // ghost 頂点ごとに自サーバの頂点からのエッジ数を数える
+    StdRandNumGenerator gen;
+    std::vector<uint32_t> crossing_num(degree_.size(), 0);
+    for (local_id_t local = 0; local < ghost_offset_; local++)
+    {
+        index_t degree = graph_->getDegreeOfLocal(local);
+        for (index_t i = 0; i < degree; i++)
+        {
+            local_id_t next_local = graph_->getNextLocalId(local, i, gen);
+            if (next_local >= ghost_offset_)
+                crossing_num[next_local - ghost_offset_]++;
+        }
+    }
+
+    std::vector<std::pair<uint32_t, local_id_t>> ranking; // (エッジ数, ghost 配列の位置)
+    for (local_id_t ghost_idx = 0; ghost_idx < crossing_num.size(); ghost_idx++)
+    {
+        if (crossing_num[ghost_idx] >= REPLICA_MIN_CROSSING_NUM)
+            ranking.emplace_back(crossing_num[ghost_idx], ghost_idx);
+    }
+    size_t hot_num = std::min<size_t>(max_num, ranking.size());
+    std::partial_sort(ranking.begin(), ranking.begin() + hot_num, ranking.end(), std::greater<std::pair<uint32_t, local_id_t>>());
+
+    node_ids.clear();
+    for (size_t i = 0; i < hot_num; i++)
+        node_ids.push_back(graph_->getGlobalId(ghost_offset_ + ranking[i].second));
+}
+
+inline void Cache::registerReplica(const vertex_id_t &node_id, const std::vector<vertex_id_t> &neighbours, const std::vector<host_id_t> &host_ids)
+{
+    local_id_t ghost_idx = getGhostIndex(node_id);
+    if (ghost_idx == INF || replicas_[ghost_idx].load() != nullptr)
+        return;
+
+    // 隣接頂点の持ち主を先に登録 (複製した隣接リストで RWer が初めて知る頂点もある)
+    for (size_t i = 0; i < neighbours.size(); i++)
+    {
+        if (!graph_->hasVertex(neighbours[i]))
+            registerHostId(neighbours[i], host_ids[i]);
+    }
+
+    // 隣接リストを公開してから次数を登録する (次数があれば index は必ず引ける)
+    // 同じ頂点を複数のスレッドが登録しようとしたら, 先に置けたものだけを使う
+    vertex_id_t *replica = new vertex_id_t[std::max<size_t>(neighbours.size(), 1)];
+    std::copy(neighbours.begin(), neighbours.end(), replica);
+    const vertex_id_t *empty = nullptr;
+    if (!replicas_[ghost_idx].compare_exchange_strong(empty, replica, std::memory_order_release, std::memory_order_relaxed))
+    {
+        delete[] replica;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_replica_);
+        replica_storage_.emplace_back(replica);
+    }
+    registerDegree(node_id, neighbours.size());
+
+    replica_vertex_num_++;
+    replica_edge_num_ += neighbours.size();
+}
+
+inline uint64_t Cache::getReplicaVertexCount()
+{
+    return replica_vertex_num_;
+}
+
+inline edge_id_t Cache::getReplicaEdgeCount()
+{
+    return replica_edge_num_;
+}
+
+inline bool Cache::saveSnapshot(const std::string &path, const uint64_t &partition_checksum)
+{
+    auto align_pos = [](const uint64_t &pos)
+    { return (pos + 7) & ~(uint64_t)7; };
+
+    CacheSnapshotHeader header = {};
+    header.magic = CACHE_SNAPSHOT_MAGIC;
+    header.version = CACHE_SNAPSHOT_VERSION;
+    header.partition_checksum = partition_checksum;
+    header.ghost_num = degree_.size();
+
+    std::vector<index_t> ghost_degrees(degree_.size());
+    for (size_t i = 0; i < degree_.size(); i++)
+        ghost_degrees[i] = has_v_[i] ? degree_[i] : CACHE_SNAPSHOT_NO_DEGREE;
+
+    std::vector<CacheSnapshotVertex> others;
+    {
+        std::shared_lock<std::shared_mutex> lock(mtx_other_vertices_);
+        others.reserve(other_vertices_.size());
+        for (auto &[node_id, cache_vertex] : other_vertices_)
+            others.push_back({node_id, cache_vertex.has_degree ? cache_vertex.degree : CACHE_SNAPSHOT_NO_DEGREE, cache_vertex.host_id, 0});
+    }
+    header.other_num = others.size();
+
+    header.ghost_pos = align_pos(sizeof(CacheSnapshotHeader));
+    header.other_pos = align_pos(header.ghost_pos + sizeof(index_t) * header.ghost_num);
+    header.entry_pos = align_pos(header.other_pos + sizeof(CacheSnapshotVertex) * header.other_num);
+
+    std::string tmp_path = path + ".tmp";
+    FILE *f = fopen(tmp_path.c_str(), "w");
+    if (f == NULL)
+    {
+        perror("fopen cache snapshot");
+        return false;
+    }
+
+    // エントリ数は書き出してみるまで分からないので, ヘッダは最後に書く
+    bool ok = fseek(f, header.ghost_pos, SEEK_SET) == 0 &&
+              fwrite(ghost_degrees.data(), sizeof(index_t), ghost_degrees.size(), f) == ghost_degrees.size() &&
+              fseek(f, header.other_pos, SEEK_SET) == 0 &&
+              fwrite(others.data(), sizeof(CacheSnapshotVertex), others.size(), f) == others.size() &&
+              fseek(f, header.entry_pos, SEEK_SET) == 0 &&
+              adjacency_list_.writeEntries(f, header.entry_num) &&
+              fseek(f, 0, SEEK_SET) == 0 &&
+              fwrite(&header, sizeof(CacheSnapshotHeader), 1, f) == 1;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        perror("write cache snapshot");
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+inline bool Cache::loadSnapshot(const std::string &path, const uint64_t &partition_checksum)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false; // まだ書き出していない
+
+    struct stat st;
+    fstat(fd, &st);
+    size_t length = st.st_size;
+
+    CacheSnapshotHeader header = {};
+    if (length < sizeof(CacheSnapshotHeader) || pread(fd, &header, sizeof(CacheSnapshotHeader), 0) != sizeof(CacheSnapshotHeader) ||
+        header.magic != CACHE_SNAPSHOT_MAGIC || header.version != CACHE_SNAPSHOT_VERSION)
+    {
+        std::cerr << "loadSnapshot: not a cache snapshot " << path << std::endl;
+        close(fd);
+        return false;
+    }
+    if (header.partition_checksum != partition_checksum || header.ghost_num != degree_.size())
+    {
+        std::cerr << "loadSnapshot: partition has changed, ignore " << path << std::endl;
+        close(fd);
+        return false;
+    }
+    if (header.ghost_pos + sizeof(index_t) * header.ghost_num > length ||
+        header.other_pos + sizeof(CacheSnapshotVertex) * header.other_num > length ||
+        header.entry_pos + sizeof(CacheSnapshotEntry) * header.entry_num > length)
+    {
+        std::cerr << "loadSnapshot: truncated file " << path << std::endl;
+        close(fd);
+        return false;
+    }
+
+    void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        perror("mmap cache snapshot");
+        return false;
+    }
+    madvise(addr, length, MADV_SEQUENTIAL);
+    const char *base = (const char *)addr;
+
+    const index_t *ghost_degrees = (const index_t *)(base + header.ghost_pos);
+    for (uint64_t i = 0; i < header.ghost_num; i++)
+    {
+        if (ghost_degrees[i] != CACHE_SNAPSHOT_NO_DEGREE)
+        {
+            degree_[i] = ghost_degrees[i];
+            has_v_[i] = true;
+        }
+    }
+
+    const CacheSnapshotVertex *others = (const CacheSnapshotVertex *)(base + header.other_pos);
+    {
+        std::lock_guard<std::shared_mutex> lock(mtx_other_vertices_);
+        other_vertices_.reserve(other_vertices_.size() + header.other_num);
+        for (uint64_t i = 0; i < header.other_num; i++)
+        {
+            CacheVertex &cache_vertex = other_vertices_[others[i].node_id];
+            cache_vertex.host_id = others[i].host_id;
+            if (others[i].degree != CACHE_SNAPSHOT_NO_DEGREE)
+            {
+                cache_vertex.degree = others[i].degree;
+                cache_vertex.has_degree = true;
+            }
+        }
+    }
+
+    const CacheSnapshotEntry *entries = (const CacheSnapshotEntry *)(base + header.entry_pos);
+    for (uint64_t i = 0; i < header.entry_num; i++)
+        adjacency_list_.setIndex(entries[i].node_ID, entries[i].index_num, entries[i].next_node_ID);
+
+    munmap(addr, length);
+    return true;
+}
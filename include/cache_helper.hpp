@@ -5,24 +5,50 @@ getNextNodeID メソッド:
 指定されたノードID（node_ID）とインデックス番号（index_num）に対応する次のノードIDを取得する。
 そのノードとインデックスがキャッシュに存在しない場合、定数 INF を返す。
 
+(頂点 ID, index) をキーとする 1 本の開番地法 (線形探索) のハッシュ表で持つ
+表の大きさは CACHE_TABLE_MEMORY (Byte) から決まり, 実行中に大きくならない (メモリ使用量が固定)
+スロットは CAS で確保し, 次の頂点を書いてから index を release で書き込んで公開するので, 読み出しはロックを取らない
+(書き込み途中のスロットは読み出し側からは「存在しない」に見えるだけ)
+1 つのキーを探すのは最初のスロットから CACHE_PROBE_LIMIT 個までで, 追い出しもこの範囲の中で行う
+
 setIndex メソッド:
 指定されたノードID（node_ID_u）とインデックス番号（index_num）に対応する次のノードID（node_ID_v）をキャッシュに設定する。
-キャッシュのサイズが MAX_CACHE_SIZE を超える場合はキャッシュ生成を停止する。
+CACHE_EVICTION_FLAG が true なら, 探索範囲に空きスロットがないときに範囲の中から CLOCK (second chance) で 1 つ追い出して入れ替える (キャッシュ生成は止めない)。
+false なら表の使用率が CACHE_TABLE_MAX_LOAD を超えた時点でキャッシュ生成を停止する。
+CLOCK の参照ビットは getNextNodeID で当たったときに立て, 追い出す候補を探すときに落とす (最近使われていないエントリから追い出す)。
+追い出すスロットは index を CAS で書き込み途中の印にしてから書き換えるので, 読み出し側は書き換え前後のどちらかの一貫したエントリを読むか, 見つからないだけ。
+
+getEvictedNum メソッド:
+追い出したエントリの数を返す。
+
+writeEntries メソッド:
+登録済みのエントリを (頂点 ID, index, 次の頂点 ID) の列としてファイルの現在位置に書き出し, 書き出した数を entry_num に入れる (スナップショット用)。
+書き込み途中・追い出し途中のスロットは飛ばす。
 */
 
 #pragma once
 
 #include <vector>
-#include <unordered_map>
-#include <shared_mutex>
+#include <atomic>
+#include <memory>
+#include <cstdio>
 
 #include "type.hpp"
+#include "vertex_index.hpp"
 #include "../config/param.hpp"
 
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
+// スナップショットファイルに書き出す 1 エントリ (24 byte)
+struct CacheSnapshotEntry
+{
+    vertex_id_t node_ID;
+    index_t index_num;
+    vertex_id_t next_node_ID;
+};
+
 class SimpleCache
 {
 
@@ -42,11 +68,42 @@ public:
     // void printList();
     uint32_t getSize();
 
+    // 追い出したエントリの数
+    uint64_t getEvictedNum();
+
+    // 登録済みのエントリをファイルに書き出す (書き込みに失敗したら false)
+    bool writeEntries(FILE *f, uint64_t &entry_num);
+
 private:
-    std::vector<std::unordered_map<index_t, vertex_id_t>> cache_;
-    std::atomic<uint64_t> cache_size_ = 0;
+    // 空きスロット (node_ID), 書き込み途中のスロット (index_num) の印
+    static const vertex_id_t EMPTY_SLOT = UINT64_MAX;
+    static const index_t PENDING_SLOT = UINT64_MAX;
+
+    struct Slot
+    {
+        std::atomic<vertex_id_t> node_ID{EMPTY_SLOT};  // CAS で確保
+        std::atomic<index_t> index_num{PENDING_SLOT}; // next_node_ID を書いてから release で公開 (追い出すときは CAS で PENDING_SLOT に戻す)
+        std::atomic<vertex_id_t> next_node_ID{INF};
+        std::atomic<uint8_t> referenced{0}; // CLOCK の参照ビット
+    };
+
+    // (頂点 ID, index) の最初のスロット
+    uint64_t getSlotPos(const vertex_id_t &node_ID, const index_t &index_num);
+
+    // 確保したスロット (index_num が PENDING_SLOT) にエントリを書いて公開する
+    void writeSlot(Slot &slot, const index_t &index_num, const vertex_id_t &node_ID_v);
+
+    // start_pos から candidate_num 個のスロットの中から CLOCK で 1 つ追い出して, エントリを書き込む (追い出せなかったら false)
+    bool evictAndSet(const uint64_t &start_pos, const uint32_t &candidate_num, const vertex_id_t &node_ID_u, const index_t &index_num, const vertex_id_t &node_ID_v);
+
+    // キャッシュ生成を止める
+    void stopCacheGeneration();
 
-    std::shared_mutex *mtx_cache_;
+    std::unique_ptr<Slot[]> slots_;
+    uint64_t mask_ = 0;        // スロット数 - 1 (スロット数は 2 の冪)
+    uint64_t max_entry_num_ = 0; // 追い出しをしないときに登録できるエントリ数の上限 (スロット数 * CACHE_TABLE_MAX_LOAD)
+    std::atomic<uint64_t> cache_size_ = 0;
+    std::atomic<uint64_t> evicted_num_ = 0;
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -55,61 +112,178 @@ private:
 
 inline void SimpleCache::init()
 {
-    cache_.resize(VERTEX_SIZE);
-    mtx_cache_ = new std::shared_mutex[VERTEX_SIZE];
+    // CACHE_TABLE_MEMORY に収まる最大の 2 の冪をスロット数にする
+    uint64_t slot_num = 1;
+    while (slot_num * 2 * sizeof(Slot) <= CACHE_TABLE_MEMORY)
+        slot_num *= 2;
+
+    slots_.reset(new Slot[slot_num]);
+    mask_ = slot_num - 1;
+    max_entry_num_ = slot_num * CACHE_TABLE_MAX_LOAD;
+}
+
+inline uint64_t SimpleCache::getSlotPos(const vertex_id_t &node_ID, const index_t &index_num)
+{
+    return hashVertexId(node_ID ^ hashVertexId(index_num)) & mask_;
 }
 
 inline vertex_id_t SimpleCache::getNextNodeID(const vertex_id_t &node_ID, const index_t &index_num)
 {
+    // 空きスロットに当たるか, CACHE_PROBE_LIMIT 個見るまで線形探索
+    uint64_t pos = getSlotPos(node_ID, index_num);
+    for (uint32_t i = 0; i < CACHE_PROBE_LIMIT; i++, pos = (pos + 1) & mask_)
     {
-        std::shared_lock<std::shared_mutex> lock(mtx_cache_[node_ID]);
+        Slot &slot = slots_[pos];
+        vertex_id_t slot_node_ID = slot.node_ID.load(std::memory_order_acquire);
+        if (slot_node_ID == EMPTY_SLOT)
+            return INF;
+        if (slot_node_ID != node_ID || slot.index_num.load(std::memory_order_acquire) != index_num)
+            continue;
 
-        // if (!cache_.contains(node_ID)) return INF;
-        if (!cache_[node_ID].contains(index_num))
+        vertex_id_t next_node_ID = slot.next_node_ID.load(std::memory_order_acquire);
+
+        // 読んでいる間に追い出されていたら見つからなかったことにする
+        if (slot.index_num.load(std::memory_order_relaxed) != index_num || slot.node_ID.load(std::memory_order_relaxed) != node_ID)
             return INF;
 
-        return cache_[node_ID][index_num];
+        // 参照ビットは立っていなければ立てる (当たるたびに書き込むとキャッシュラインの取り合いになるので)
+        if (!slot.referenced.load(std::memory_order_relaxed))
+            slot.referenced.store(1, std::memory_order_relaxed);
+        return next_node_ID;
     }
+    return INF;
 }
 
 inline void SimpleCache::setIndex(const vertex_id_t &node_ID_u, const index_t &index_num, const vertex_id_t &node_ID_v)
 {
-    // if (cache_size_ >= MAX_CACHE_SIZE) return;
-    if (cache_size_ + MY_EDGE_NUM >= MAX_CACHE_SIZE)
+    if (!CACHE_EVICTION_FLAG && cache_size_ >= max_entry_num_)
     {
-        CHECK_RWER_FLAG = false;
-        CACHE_GEN_FLAG = false;
+        stopCacheGeneration();
         return;
     }
 
-    bool exist_edge = false;
+    uint64_t start_pos = getSlotPos(node_ID_u, index_num);
+    uint64_t pos = start_pos;
+    for (uint32_t i = 0; i < CACHE_PROBE_LIMIT; i++, pos = (pos + 1) & mask_)
+    {
+        Slot &slot = slots_[pos];
+        vertex_id_t slot_node_ID = slot.node_ID.load(std::memory_order_acquire);
+        if (slot_node_ID == EMPTY_SLOT)
+        {
+            if (slot.node_ID.compare_exchange_strong(slot_node_ID, node_ID_u, std::memory_order_acq_rel))
+            { // スロットを確保できたので, 次の頂点を書いてから公開
+                writeSlot(slot, index_num, node_ID_v);
+
+                if (++cache_size_ >= max_entry_num_ && !CACHE_EVICTION_FLAG)
+                    stopCacheGeneration();
+                return;
+            }
+            // 他のスレッドに先に確保された (slot_node_ID にその頂点 ID が入る)
+        }
+
+        if (slot_node_ID == node_ID_u)
+        {
+            // 同じ頂点のスロットが書き込み途中なら, 公開されるまで待ってから index を比べる
+            index_t slot_index_num;
+            while ((slot_index_num = slot.index_num.load(std::memory_order_acquire)) == PENDING_SLOT)
+                ;
+            if (slot_index_num == index_num)
+                return; // 既に登録済み
+        }
+    }
+
+    if (!CACHE_EVICTION_FLAG)
     {
-        std::shared_lock<std::shared_mutex> lock(mtx_cache_[node_ID_u]);
-        if (cache_[node_ID_u].contains(index_num))
-            exist_edge = true;
+        stopCacheGeneration();
+        return;
     }
 
-    if (!exist_edge)
+    // 探索範囲に空きがないので, 範囲の中から追い出す
+    evictAndSet(start_pos, CACHE_PROBE_LIMIT, node_ID_u, index_num, node_ID_v);
+}
+
+inline void SimpleCache::writeSlot(Slot &slot, const index_t &index_num, const vertex_id_t &node_ID_v)
+{
+    slot.referenced.store(0, std::memory_order_relaxed);
+    slot.next_node_ID.store(node_ID_v, std::memory_order_release);
+    slot.index_num.store(index_num, std::memory_order_release);
+}
+
+inline bool SimpleCache::evictAndSet(const uint64_t &start_pos, const uint32_t &candidate_num, const vertex_id_t &node_ID_u, const index_t &index_num, const vertex_id_t &node_ID_v)
+{
+    // 1 周目で参照ビットを落としていくので, 2 周目には (その間に使われていなければ) 必ず候補が見つかる
+    for (uint32_t round = 0; round < 2; round++)
     {
+        uint64_t pos = start_pos;
+        for (uint32_t i = 0; i < candidate_num; i++, pos = (pos + 1) & mask_)
         {
-            std::lock_guard<std::shared_mutex> lock(mtx_cache_[node_ID_u]);
-
-            if (!cache_[node_ID_u].contains(index_num))
-            {
-                cache_[node_ID_u][index_num] = node_ID_v;
-                cache_size_++;
-                // if (cache_size_ >= MAX_CACHE_SIZE) {
-                if (cache_size_ + MY_EDGE_NUM >= MAX_CACHE_SIZE)
-                {
-                    CHECK_RWER_FLAG = false;
-                    CACHE_GEN_FLAG = false;
-                }
-            }
+            Slot &slot = slots_[pos];
+            index_t slot_index_num = slot.index_num.load(std::memory_order_acquire);
+            if (slot_index_num == PENDING_SLOT)
+                continue; // 書き込み途中
+
+            if (slot.referenced.exchange(0, std::memory_order_relaxed))
+                continue; // 最近使われたので次の機会まで残す
+
+            // index を書き込み途中の印にして確保してから, 頂点 ID を書き換える (読み出し側は index を見て外れる)
+            if (!slot.index_num.compare_exchange_strong(slot_index_num, PENDING_SLOT, std::memory_order_acq_rel))
+                continue; // 他のスレッドに先に追い出された
+
+            slot.node_ID.store(node_ID_u, std::memory_order_release);
+            writeSlot(slot, index_num, node_ID_v);
+            evicted_num_++;
+            return true;
         }
     }
+    return false;
+}
+
+inline void SimpleCache::stopCacheGeneration()
+{
+    CHECK_RWER_FLAG = false;
+    CACHE_GEN_FLAG = false;
 }
 
 inline uint32_t SimpleCache::getSize()
 {
     return cache_size_;
-}
\ No newline at end of file
+}
+
+inline uint64_t SimpleCache::getEvictedNum()
+{
+    return evicted_num_;
+}
+
+inline bool SimpleCache::writeEntries(FILE *f, uint64_t &entry_num)
+{
+    const uint32_t BUFFER_ENTRY_NUM = 4096;
+    std::vector<CacheSnapshotEntry> buffer;
+    buffer.reserve(BUFFER_ENTRY_NUM);
+    entry_num = 0;
+
+    for (uint64_t pos = 0; pos <= mask_; pos++)
+    {
+        Slot &slot = slots_[pos];
+        vertex_id_t slot_node_ID = slot.node_ID.load(std::memory_order_acquire);
+        index_t slot_index_num = slot.index_num.load(std::memory_order_acquire);
+        if (slot_node_ID == EMPTY_SLOT || slot_index_num == PENDING_SLOT)
+            continue;
+        vertex_id_t next_node_ID = slot.next_node_ID.load(std::memory_order_acquire);
+        if (slot.index_num.load(std::memory_order_relaxed) != slot_index_num || slot.node_ID.load(std::memory_order_relaxed) != slot_node_ID)
+            continue; // 読んでいる間に追い出された
+
+        buffer.push_back({slot_node_ID, slot_index_num, next_node_ID});
+        if (buffer.size() == BUFFER_ENTRY_NUM)
+        {
+            if (fwrite(buffer.data(), sizeof(CacheSnapshotEntry), buffer.size(), f) != buffer.size())
+                return false;
+            entry_num += buffer.size();
+            buffer.clear();
+        }
+    }
+
+    if (fwrite(buffer.data(), sizeof(CacheSnapshotEntry), buffer.size(), f) != buffer.size())
+        return false;
+    entry_num += buffer.size();
+    return true;
+}
@@ -0,0 +1,241 @@
+/*
+終了した RWer の経路 (頂点 ID の列) をコーパスとしてファイルに書き出す
+word2vec / DeepWalk などの学習にそのまま使えるように, 1 経路を 1 レコードとして CORPUS_SHARD_NUM 個のファイルに分けて書く
+walkEngine スレッドは経路をシャードごとのバッファ (CORPUS_BUFFER_SIZE) に詰めるだけで, ファイルへの書き込みは専用の書き込みスレッドが行う
+書き込み待ちのバッファは CORPUS_QUEUE_BUFFER_NUM 個までで, 書き込みが追いつかずバッファが足りないときは RWer を待たせずに捨てて数える
+
+出力形式:
+CORPUS_TEXT_FLAG が true なら 1 行 1 経路 (頂点 ID の空白区切り)
+false なら {経路長(32bit), 頂点 ID(64bit) * 経路長} の繰り返し
+
+init メソッド:
+出力先ファイル (path_prefix + "_" + シャード番号 + ".txt" or ".bin") を開き, 書き込みスレッドを開始します。
+
+addRWer メソッド:
+RWer の経路をシャード (RWer_id % CORPUS_SHARD_NUM) のバッファに追加します。バッファが埋まったら書き込みスレッドに渡します。
+
+flush メソッド:
+全てのシャードのバッファを書き込みスレッドに渡し, ファイルに書き出されるまで待ちます。
+
+getDroppedNum メソッド:
+バッファが足りずに捨てた RWer の数を返します。
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <charconv>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+
+#include "type.hpp"
+#include "random_walker.hpp"
+#include "../config/param.hpp"
+
+class CorpusWriter
+{
+
+public:
+    ~CorpusWriter();
+
+    // 出力先ファイルを開き, 書き込みスレッドを開始
+    void init(const std::string &path_prefix);
+
+    // RWer の経路をバッファに追加
+    void addRWer(RandomWalker &RWer);
+
+    // バッファの中身を全てファイルに書き出すまで待つ
+    void flush();
+
+    // バッファが足りずに捨てた RWer の数を入手
+    uint64_t getDroppedNum();
+
+private:
+    // 書き込みスレッドの処理
+    void writeLoop();
+
+    // シャードの書きかけのバッファを書き込み待ちに回す (mtx_shards_[shard_id] を取った状態で呼ぶ, 空きバッファがなければ false)
+    bool handOverBuffer(const uint32_t &shard_id);
+
+    std::vector<FILE *> files_;                   // シャードごとの出力先
+    std::vector<std::vector<char>> buffers_;      // シャードごとの書きかけのバッファ
+    std::unique_ptr<std::mutex[]> mtx_shards_;    // シャードごとのロック
+    std::vector<std::vector<char>> free_buffers_; // 空きバッファ
+    std::deque<std::pair<uint32_t, std::vector<char>>> full_buffers_; // 書き込み待ちのバッファ (シャード番号, 中身)
+    uint32_t writing_num_ = 0;                    // 書き込み中のバッファの数
+    bool stop_flag_ = false;
+    std::mutex mtx_;
+    std::condition_variable cv_write_; // 書き込み待ちのバッファが来た
+    std::condition_variable cv_done_;  // バッファが空いた
+    std::atomic<uint64_t> dropped_num_{0};
+    std::thread writer_;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+inline CorpusWriter::~CorpusWriter()
+{
+    if (!writer_.joinable())
+        return;
+
+    flush();
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_flag_ = true;
+    }
+    cv_write_.notify_all();
+    writer_.join();
+    for (FILE *f : files_)
+        fclose(f);
+}
+
+inline void CorpusWriter::init(const std::string &path_prefix)
+{
+    mtx_shards_.reset(new std::mutex[CORPUS_SHARD_NUM]);
+    for (uint32_t i = 0; i < CORPUS_SHARD_NUM; i++)
+    {
+        std::string path = path_prefix + "_" + std::to_string(i) + (CORPUS_TEXT_FLAG ? ".txt" : ".bin");
+        FILE *f = fopen(path.c_str(), "w");
+        if (f == NULL)
+        {
+            perror("fopen corpus");
+            exit(1); // 異常終了
+        }
+        setvbuf(f, NULL, _IONBF, 0); // 書き込みスレッドが大きなバッファ単位で書くので stdio のバッファは使わない
+        files_.push_back(f);
+
+        buffers_.emplace_back();
+        buffers_.back().reserve(CORPUS_BUFFER_SIZE);
+    }
+    for (uint32_t i = 0; i < CORPUS_QUEUE_BUFFER_NUM; i++)
+    {
+        free_buffers_.emplace_back();
+        free_buffers_.back().reserve(CORPUS_BUFFER_SIZE);
+    }
+
+    writer_ = std::thread(&CorpusWriter::writeLoop, this);
+}
+
+inline void CorpusWriter::addRWer(RandomWalker &RWer)
+{
+    // path: (頂点, ホストID, 次数, indexuv, indexvu), (), (), ...
+    uint16_t path_length = 0;
+    std::vector<uint64_t> path;
+    RWer.getPath(path_length, path);
+
+    // レコードをスレッドごとの作業領域に作ってから, ロックを取ってバッファにコピーする
+    thread_local std::vector<char> record;
+    record.clear();
+    if (CORPUS_TEXT_FLAG)
+    {
+        record.resize((size_t)path_length * 21 + 1); // 64bit の 10 進数 (最大 20 桁) + 区切り
+        char *p = record.data();
+        for (uint16_t i = 0; i < path_length; i++)
+        {
+            if (i > 0)
+                *p++ = ' ';
+            p = std::to_chars(p, record.data() + record.size(), path[i * 5]).ptr;
+        }
+        *p++ = '\n';
+        record.resize(p - record.data());
+    }
+    else
+    {
+        uint32_t length = path_length;
+        record.resize(sizeof(uint32_t) + sizeof(uint64_t) * length);
+        memcpy(record.data(), &length, sizeof(uint32_t));
+        for (uint16_t i = 0; i < path_length; i++)
+            memcpy(record.data() + sizeof(uint32_t) + sizeof(uint64_t) * i, &path[i * 5], sizeof(uint64_t));
+    }
+
+    uint32_t shard_id = RWer.getRWerID() % CORPUS_SHARD_NUM;
+    std::lock_guard<std::mutex> lk(mtx_shards_[shard_id]);
+    std::vector<char> &buffer = buffers_[shard_id];
+    if (buffer.size() + record.size() > CORPUS_BUFFER_SIZE && !buffer.empty() && !handOverBuffer(shard_id))
+    { // 書き込みが追いついていない (RWer を待たせずに捨てる)
+        dropped_num_++;
+        return;
+    }
+    buffer.insert(buffer.end(), record.begin(), record.end());
+}
+
+inline void CorpusWriter::flush()
+{
+    for (uint32_t i = 0; i < CORPUS_SHARD_NUM; i++)
+    {
+        std::lock_guard<std::mutex> lk_shard(mtx_shards_[i]);
+        if (buffers_[i].empty())
+            continue;
+
+        // 空きバッファができるまで待って, 書きかけのバッファを渡す
+        std::unique_lock<std::mutex> lk(mtx_);
+        cv_done_.wait(lk, [&]
+                      { return !free_buffers_.empty(); });
+        full_buffers_.emplace_back(i, std::move(buffers_[i]));
+        buffers_[i] = std::move(free_buffers_.back());
+        free_buffers_.pop_back();
+        cv_write_.notify_one();
+    }
+
+    // 書き込み待ちのバッファが全てファイルに書き出されるまで待つ
+    std::unique_lock<std::mutex> lk(mtx_);
+    cv_done_.wait(lk, [&]
+                  { return full_buffers_.empty() && writing_num_ == 0; });
+}
+
+inline uint64_t CorpusWriter::getDroppedNum()
+{
+    return dropped_num_;
+}
+
+inline void CorpusWriter::writeLoop()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        cv_write_.wait(lk, [&]
+                       { return !full_buffers_.empty() || stop_flag_; });
+        if (full_buffers_.empty())
+            return; // stop_flag_
+
+        uint32_t shard_id = full_buffers_.front().first;
+        std::vector<char> buffer = std::move(full_buffers_.front().second);
+        full_buffers_.pop_front();
+        writing_num_++;
+        lk.unlock();
+
+        if (fwrite(buffer.data(), 1, buffer.size(), files_[shard_id]) != buffer.size())
+        {
+            perror("fwrite corpus");
+            exit(1); // 異常終了
+        }
+        buffer.clear();
+
+        lk.lock();
+        free_buffers_.push_back(std::move(buffer));
+        writing_num_--;
+        cv_done_.notify_all();
+    }
+}
+
+inline bool CorpusWriter::handOverBuffer(const uint32_t &shard_id)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (free_buffers_.empty())
+        return false;
+
+    full_buffers_.emplace_back(shard_id, std::move(buffers_[shard_id]));
+    buffers_[shard_id] = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+    cv_write_.notify_one();
+    return true;
+}
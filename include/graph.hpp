@@ -4,7 +4,17 @@ raph クラスを定義しており、グラフデータを読み込み、管理
 
 init メソッド:
 指定されたディレクトリパス、ホストID文字列、およびホストIDを使用してグラフデータを初期化します。
-グラフファイルからエッジデータを読み込み、内部データ構造に保存します。
+グラフファイルが CSR 形式のパーティションファイルなら mmap してそのまま参照します (パース処理なし)。
+旧形式 (Edge_dstIp の配列) の場合は読み込んでメモリ上で CSR 形式 (オフセット配列 + 隣接頂点配列) を構築します。
+重み付きのパーティションなら, 自サーバの頂点ごとに alias table を構築します。
+
+isWeighted メソッド:
+グラフが重み付きかどうかを返します。
+
+sampleNextIndexOfLocal メソッド:
+次の遷移先の index (隣接リスト内の位置) をランダムに選びます。
+重みなしなら一様に, 重み付きなら alias table で重みに比例した確率で O(1) で選びます。
+index はどちらも持ち主の隣接リスト (グローバル ID の昇順) の位置なので, 他サーバに送る next_index や経路情報の index の意味は変わりません。
 
 getMyVerticesNum メソッド:
 自サーバが持ち主となる頂点の数を返します。
@@ -16,6 +26,7 @@ getMyVertices メソッド:
 getHostId メソッド:
 指定されたノードIDのホストIDを返します。
 ホストIDとは？
+自サーバのパーティションに現れない頂点の場合は INF を返します。
 
 getDegree メソッド:
 指定されたノードIDの次数を返します。
@@ -27,10 +38,28 @@ getNextNodeID メソッド:
 指定されたノードIDとインデックスに基づいて次のノードIDを返します。
 インデックスが次数を超える場合はランダムな隣接ノードを返します。
 
+getLocalId / getGlobalId メソッド:
+グローバル頂点 ID とローカル頂点 ID を相互に変換します。
+自サーバの頂点はローカル ID [0, 自サーバの頂点数), 境界の他サーバ頂点 (ghost) はその後ろに詰めて並びます。
+グローバル ID からの変換はハッシュ表 (VertexIndex) で行い, パーティションに現れない頂点は INF を返します。
+ローカル ID を受け取る ...OfLocal 系のメソッドを使えば, 1 歩ごとの変換は 1 回で済みます。
+
+prefetchIndex / prefetchOffsets / prefetchNeighbours メソッド:
+RW の 1 歩で参照するデータ (ハッシュ表のスロット, オフセット, 隣接リスト) を段階的にソフトウェアプリフェッチします。
+複数の RWer を交互に進めるときに, 他の RWer を進めている間にメモリアクセスの待ち時間を隠すために使います。
+
 indexOfUV メソッド:
 指定された2つのノードIDに基づいて、ノードUの隣接リストにおけるノードVのインデックスを返します。
 ノードUが自サーバのものでない場合は INF を返します。
 
+hasEdgeOfLocal メソッド:
+自サーバの頂点 U の隣接リストに頂点 V があるかを二分探索で確認します (node2vec の隣接判定用)。
+
+getChecksum メソッド:
+パーティション (頂点数, エッジ数, グローバル ID 配列, オフセット配列, 隣接頂点配列, HostID 配列) と, ヘッダにある分割全体のチェックサムを混ぜたチェックサムを返します。
+キャッシュのスナップショットが同じ分割から作られたものか確かめるのに使います (キャッシュの中身は他サーバのパーティションの隣接リストなので, 他サーバのパーティションが変わっても一致しないようにする)。
+分割全体のチェックサムがないファイル (バージョン 3 以前, 旧形式) なら 0 を返します。初回だけ全体を読むので, 結果は保存しておきます。
+
 
 */
 #pragma once
@@ -38,10 +67,11 @@ indexOfUV メソッド:
 #include <iostream>
 #include <string>
 #include <vector>
-#include <unordered_set>
+#include <algorithm>
 
 #include "type.hpp"
 #include "storage.hpp"
+#include "vertex_index.hpp"
 #include "util.hpp"
 #include "../config/param.hpp"
 
@@ -61,32 +91,81 @@ public:
     // 自サーバが持ち主となる頂点集合を入手
     std::vector<vertex_id_t> getMyVertices();
 
-    // 頂点の持ち主の HostID を入手
+    // ghost 頂点 (自サーバの頂点に隣接する他サーバの頂点) の数を入手
+    local_id_t getGhostVerticesNum();
+
+    // グローバル ID -> ローカル ID (パーティションに現れない頂点は INF)
+    local_id_t getLocalId(const vertex_id_t &node_id);
+
+    // ローカル ID -> グローバル ID
+    vertex_id_t getGlobalId(const local_id_t &local_id);
+
+    // ローカル ID の頂点の持ち主が自サーバであるか確認
+    bool isMyLocalId(const local_id_t &local_id);
+
+    // 頂点の持ち主の HostID を入手 (不明なら INF)
     host_id_t getHostId(const vertex_id_t &node_id);
+    host_id_t getHostIdOfLocal(const local_id_t &local_id);
 
     // 頂点の次数を入手
     index_t getDegree(const vertex_id_t &node_id);
+    index_t getDegreeOfLocal(const local_id_t &local_id);
 
     // 頂点の持ち主が自サーバであるか確認
     bool hasVertex(const vertex_id_t &node_id);
 
     // 現在頂点とインデックスを引数にして次の頂点を返す
     vertex_id_t getNextNodeID(const vertex_id_t &current_node, const index_t &next_index, StdRandNumGenerator &gen);
+    local_id_t getNextLocalId(const local_id_t &current_local, const index_t &next_index, StdRandNumGenerator &gen);
+
+    // 重み付きグラフかどうか
+    bool isWeighted();
+
+    // 次の遷移先の index をランダムに選ぶ (重み付きなら重みに比例した確率)
+    index_t sampleNextIndexOfLocal(const local_id_t &current_local, const index_t &degree, StdRandNumGenerator &gen);
 
     // 頂点 u, v を受け取り, u[x] = v の x を返す (index を返す)
     // 頂点 u が自分のサーバのものでない場合は INF を返す
     index_t indexOfUV(const vertex_id_t &node_id_u, const vertex_id_t &node_id_v);
+    index_t indexOfUVOfLocal(const local_id_t &local_u, const vertex_id_t &node_id_v);
+
+    // 自サーバの頂点 u (ローカル ID) と頂点 v の間にエッジ u -> v があるか確認
+    bool hasEdgeOfLocal(const local_id_t &local_u, const vertex_id_t &node_id_v);
+
+    // RW の 1 歩で参照するデータのプリフェッチ
+    void prefetchIndex(const vertex_id_t &node_id);
+    void prefetchOffsets(const local_id_t &local_id);
+    void prefetchNeighbours(const local_id_t &local_id);
 
     // グラフのエッジカウント
     edge_id_t getEdgeCount();
 
+    // パーティションのチェックサム (分割全体のチェックサムがなければ 0)
+    uint64_t getChecksum();
+
 private:
-    std::vector<vertex_id_t> my_vertices_vector_;          // 自サーバが持ち主となる頂点集合 (配列)
-    std::vector<host_id_t> vertices_host_id_;              // 自サーバが保持している頂点の持ち主の IP アドレス {頂点 ID : IP アドレス (頂点の持ち主)}
-    std::vector<std::vector<vertex_id_t>> adjacency_list_; // 自サーバの隣接リスト {頂点 ID : 隣接リスト}
-    std::vector<index_t> degree_;                          // 自サーバが持ち主となる頂点の次数
-    std::vector<bool> has_v_;
+    // 自サーバの頂点ごとの alias table を構築
+    void buildAliasTables();
+
+    std::vector<vertex_id_t> my_vertices_vector_; // 自サーバが持ち主となる頂点集合 (配列)
+    const vertex_id_t *global_ids_ = nullptr;     // ローカル ID -> グローバル ID
+    const edge_id_t *offsets_ = nullptr;          // CSR のオフセット配列 (ローカル ID v の隣接リストは neighbours_[offsets_[v], offsets_[v + 1]))
+    const local_id_t *neighbours_ = nullptr;      // CSR の隣接頂点配列 (ローカル ID, 頂点ごとにグローバル ID の昇順)
+    const host_id_t *vertices_host_id_ = nullptr; // 自サーバが保持している頂点の持ち主 {ローカル ID : HostID (頂点の持ち主)}
+    VertexIndex index_;                           // グローバル ID -> ローカル ID
+    local_id_t owned_num_ = 0;                    // 自サーバが持ち主の頂点数
+    local_id_t local_num_ = 0;                    // ローカル ID を持つ頂点数
     edge_id_t edge_count_;
+    uint64_t checksum_ = 0;                       // パーティションのチェックサム (0 なら未計算)
+    uint64_t partitioning_checksum_ = 0;          // 分割全体のチェックサム (ヘッダの値, 0 なら不明)
+
+    // 重み付きグラフ用 (重みなしなら空)
+    const edge_weight_t *weights_ = nullptr; // エッジの重み (隣接頂点配列と同じ並び)
+    std::vector<uint32_t> alias_prob_;       // alias table の列 i をそのまま選ぶ確率 (2^32 倍), 隣接頂点配列と同じ並び
+    std::vector<uint32_t> alias_idx_;        // alias table の列 i の別名 (隣接リスト内の位置)
+
+    MappedPartition mapped_;  // mmap したパーティションファイル
+    PartitionData partition_; // 旧形式のファイルから構築したパーティションデータ
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -96,43 +175,45 @@ private:
 inline void Graph::init(const std::string &dir_path, const std::string &host_id_str, const host_id_t &hostid)
 {
     std::string graph_file_path = dir_path + host_id_str + ".data"; // グラフファイルのパス
-    Edge_dstIp *read_edges;
-    edge_id_t read_e_num;
-    read_graph(graph_file_path.c_str(), read_edges, read_e_num);
-    edge_count_ = read_e_num;
-    MY_EDGE_NUM = edge_count_;
-    std::cout << "MY_EDGE_NUM: " << MY_EDGE_NUM << std::endl;
 
-    // node_id の最大値を確認
-    vertex_id_t mx_id = 0;
-    for (int e_i = 0; e_i < read_e_num; e_i++)
-    {
-        mx_id = std::max((vertex_id_t)read_edges[e_i].src, mx_id);
+    if (map_partition(graph_file_path.c_str(), mapped_))
+    { // パーティションファイルをそのまま参照
+        owned_num_ = mapped_.header->owned_num;
+        local_num_ = mapped_.header->local_num;
+        edge_count_ = mapped_.header->edge_num;
+        global_ids_ = mapped_.global_ids;
+        offsets_ = mapped_.offsets;
+        neighbours_ = mapped_.neighbours;
+        vertices_host_id_ = mapped_.host_ids;
+        index_.attach(mapped_.index_slots, mapped_.header->index_slot_num);
+        weights_ = mapped_.weights;
+        partitioning_checksum_ = mapped_.partitioning_checksum;
+    }
+    else
+    { // 旧形式: エッジ列から CSR を構築
+        Edge_dstIp *read_edges;
+        edge_id_t read_e_num;
+        read_graph(graph_file_path.c_str(), read_edges, read_e_num);
+        build_partition(read_edges, read_e_num, hostid, partition_);
+        delete[] read_edges;
+
+        owned_num_ = partition_.owned_num;
+        local_num_ = partition_.global_ids.size();
+        edge_count_ = partition_.neighbours.size();
+        global_ids_ = partition_.global_ids.data();
+        offsets_ = partition_.offsets.data();
+        neighbours_ = partition_.neighbours.data();
+        vertices_host_id_ = partition_.host_ids.data();
+        index_.attach(partition_.index_slots.data(), partition_.index_slots.size());
     }
+    MY_EDGE_NUM = edge_count_;
+    std::cout << "MY_EDGE_NUM: " << MY_EDGE_NUM << std::endl;
 
-    // データ構造のサイズ指定
-    vertices_host_id_.resize(VERTEX_SIZE);
-    adjacency_list_.resize(mx_id + 1);
-    degree_.resize(mx_id + 1);
-    has_v_.resize(VERTEX_SIZE);
+    if (weights_ != nullptr)
+        buildAliasTables();
 
-    // エッジデータを入れていく
-    std::unordered_set<vertex_id_t> v_st;
-    for (int e_i = 0; e_i < read_e_num; e_i++)
-    {
-        auto e = read_edges[e_i];
-        v_st.insert(e.src);
-        vertices_host_id_[e.src] = hostid;
-        vertices_host_id_[e.dst] = e.dst_ip;
-        adjacency_list_[e.src].push_back(e.dst);
-        has_v_[e.src] = true;
-    }
-    for (vertex_id_t v : v_st)
-    {
-        degree_[v] = adjacency_list_[v].size();
-        sort(adjacency_list_[v].begin(), adjacency_list_[v].end());
-        my_vertices_vector_.push_back(v);
-    }
+    // 自サーバの頂点はローカル ID の先頭に並んでいる
+    my_vertices_vector_.assign(global_ids_, global_ids_ + owned_num_);
 }
 
 inline vertex_id_t Graph::getMyVerticesNum()
@@ -145,55 +226,153 @@ inline std::vector<vertex_id_t> Graph::getMyVertices()
     return my_vertices_vector_;
 }
 
+inline local_id_t Graph::getGhostVerticesNum()
+{
+    return local_num_ - owned_num_;
+}
+
+inline local_id_t Graph::getLocalId(const vertex_id_t &node_id)
+{
+    return index_.find(node_id);
+}
+
+inline vertex_id_t Graph::getGlobalId(const local_id_t &local_id)
+{
+    return global_ids_[local_id];
+}
+
+inline bool Graph::isMyLocalId(const local_id_t &local_id)
+{
+    return local_id < owned_num_;
+}
+
 inline host_id_t Graph::getHostId(const vertex_id_t &node_id)
 {
-    try
-    {
-        return vertices_host_id_[node_id];
-    }
-    catch (std::out_of_range &oor)
-    {
-        std::cerr << "graph getHostId node_id: " << node_id << std::endl;
-        exit(1);
-    }
+    // 自サーバのパーティションに現れない頂点は INF
+    local_id_t local_id = getLocalId(node_id);
+    if (local_id == INF)
+        return INF;
+    return vertices_host_id_[local_id];
+}
+
+inline host_id_t Graph::getHostIdOfLocal(const local_id_t &local_id)
+{
+    return vertices_host_id_[local_id];
 }
 
 inline index_t Graph::getDegree(const vertex_id_t &node_id)
 {
-    try
-    {
-        return degree_[node_id];
-    }
-    catch (std::out_of_range &oor)
+    local_id_t local_id = getLocalId(node_id);
+    if (!isMyLocalId(local_id))
     {
         std::cerr << "graph getDegree node_id: " << node_id << std::endl;
         exit(1);
     }
+    return getDegreeOfLocal(local_id);
+}
+
+inline index_t Graph::getDegreeOfLocal(const local_id_t &local_id)
+{
+    return offsets_[local_id + 1] - offsets_[local_id];
 }
 
 inline bool Graph::hasVertex(const vertex_id_t &node_id)
 {
-    assert(node_id < VERTEX_SIZE);
-    return has_v_[node_id];
+    return isMyLocalId(getLocalId(node_id));
 }
 
 inline vertex_id_t Graph::getNextNodeID(const vertex_id_t &current_node, const vertex_id_t &next_index, StdRandNumGenerator &gen)
 {
-    if (degree_[current_node] <= next_index)
+    return getGlobalId(getNextLocalId(getLocalId(current_node), next_index, gen));
+}
+
+inline local_id_t Graph::getNextLocalId(const local_id_t &current_local, const index_t &next_index, StdRandNumGenerator &gen)
+{
+    index_t degree = getDegreeOfLocal(current_local);
+    if (degree <= next_index)
     { // はみ出てる時
         std::cout << "segfault at getNextNode" << std::endl;
-        return adjacency_list_[current_node][gen.gen(degree_[current_node])];
+        return neighbours_[offsets_[current_local] + gen.gen(degree)];
     }
 
-    try
-    {
-        return adjacency_list_[current_node][next_index];
-    }
-    catch (std::out_of_range &oor)
+    return neighbours_[offsets_[current_local] + next_index];
+}
+
+inline bool Graph::isWeighted()
+{
+    return weights_ != nullptr;
+}
+
+inline void Graph::buildAliasTables()
+{
+    alias_prob_.resize(edge_count_);
+    alias_idx_.resize(edge_count_);
+
+    // Vose の方法 (頂点ごとに独立なので並列に構築)
+#pragma omp parallel
     {
-        std::cerr << "graph getNextNode current_node: " << current_node << std::endl;
-        exit(1);
+        std::vector<double> scaled;
+        std::vector<uint32_t> small, large;
+
+#pragma omp for schedule(dynamic, 1024)
+        for (local_id_t v = 0; v < owned_num_; v++)
+        {
+            edge_id_t offset = offsets_[v];
+            uint32_t degree = offsets_[v + 1] - offset;
+
+            double weight_sum = 0;
+            for (uint32_t i = 0; i < degree; i++)
+                weight_sum += std::max<edge_weight_t>(weights_[offset + i], 0);
+
+            // 列 i をそのまま選ぶ確率は 1 で初期化 (重みの合計が 0 なら一様)
+            for (uint32_t i = 0; i < degree; i++)
+            {
+                alias_prob_[offset + i] = UINT32_MAX;
+                alias_idx_[offset + i] = i;
+            }
+            if (weight_sum <= 0)
+                continue;
+
+            scaled.resize(degree);
+            small.clear();
+            large.clear();
+            for (uint32_t i = 0; i < degree; i++)
+            {
+                scaled[i] = std::max<edge_weight_t>(weights_[offset + i], 0) * degree / weight_sum;
+                if (scaled[i] < 1)
+                    small.push_back(i);
+                else
+                    large.push_back(i);
+            }
+            while (!small.empty() && !large.empty())
+            {
+                uint32_t s = small.back(), l = large.back();
+                small.pop_back();
+                alias_prob_[offset + s] = (uint32_t)(scaled[s] * 4294967296.0);
+                alias_idx_[offset + s] = l;
+                scaled[l] -= 1 - scaled[s];
+                if (scaled[l] < 1)
+                {
+                    large.pop_back();
+                    small.push_back(l);
+                }
+            }
+            // 残りは誤差で 1 からずれているだけなので確率 1 のまま
+        }
     }
+    std::cout << "alias table built" << std::endl;
+}
+
+inline index_t Graph::sampleNextIndexOfLocal(const local_id_t &current_local, const index_t &degree, StdRandNumGenerator &gen)
+{
+    index_t column = gen.gen(degree);
+    if (weights_ == nullptr)
+        return column;
+
+    edge_id_t e = offsets_[current_local] + column;
+    if ((uint32_t)(gen.next() >> 32) < alias_prob_[e])
+        return column;
+    return alias_idx_[e];
 }
 
 inline index_t Graph::indexOfUV(const vertex_id_t &node_id_u, const vertex_id_t &node_id_v)
@@ -204,11 +383,74 @@ inline index_t Graph::indexOfUV(const vertex_id_t &node_id_u, const vertex_id_t
         std::cout << "don't have " << node_id_u << std::endl;
         return INF;
     }
-    index_t idx = std::lower_bound(adjacency_list_[node_id_u].begin(), adjacency_list_[node_id_u].end(), node_id_v) - adjacency_list_[node_id_u].begin();
+    return indexOfUVOfLocal(getLocalId(node_id_u), node_id_v);
+}
+
+inline index_t Graph::indexOfUVOfLocal(const local_id_t &local_u, const vertex_id_t &node_id_v)
+{
+    const local_id_t *begin = neighbours_ + offsets_[local_u];
+    const local_id_t *end = neighbours_ + offsets_[local_u + 1];
+    index_t idx = std::lower_bound(begin, end, node_id_v, [&](const local_id_t &a, const vertex_id_t &v)
+                                   { return global_ids_[a] < v; }) -
+                  begin;
     return idx;
 }
 
+inline bool Graph::hasEdgeOfLocal(const local_id_t &local_u, const vertex_id_t &node_id_v)
+{
+    index_t idx = indexOfUVOfLocal(local_u, node_id_v);
+    return idx < getDegreeOfLocal(local_u) && global_ids_[neighbours_[offsets_[local_u] + idx]] == node_id_v;
+}
+
+inline void Graph::prefetchIndex(const vertex_id_t &node_id)
+{
+    index_.prefetch(node_id);
+}
+
+inline void Graph::prefetchOffsets(const local_id_t &local_id)
+{
+    __builtin_prefetch(&offsets_[local_id]);
+}
+
+inline void Graph::prefetchNeighbours(const local_id_t &local_id)
+{
+    __builtin_prefetch(&neighbours_[offsets_[local_id]]);
+    if (weights_ != nullptr)
+    {
+        __builtin_prefetch(&alias_prob_[offsets_[local_id]]);
+        __builtin_prefetch(&alias_idx_[offsets_[local_id]]);
+    }
+}
+
 inline edge_id_t Graph::getEdgeCount()
 {
     return edge_count_;
-}
\ No newline at end of file
+}
+
+inline uint64_t Graph::getChecksum()
+{
+    if (checksum_ != 0 || partitioning_checksum_ == 0)
+        return checksum_;
+
+    uint64_t checksum = 0x9e3779b97f4a7c15ULL;
+    auto mix = [&](const uint64_t &value)
+    { checksum = hashVertexId(checksum ^ value) + 0x9e3779b97f4a7c15ULL; };
+
+    mix(partitioning_checksum_);
+    mix(owned_num_);
+    mix(local_num_);
+    mix(edge_count_);
+    mix(weights_ != nullptr);
+    for (local_id_t local = 0; local < local_num_; local++)
+    {
+        mix(global_ids_[local]);
+        mix(vertices_host_id_[local]);
+    }
+    for (local_id_t local = 0; local <= owned_num_; local++)
+        mix(offsets_[local]);
+    for (edge_id_t e = 0; e < edge_count_; e++)
+        mix(neighbours_[e]);
+
+    checksum_ = (checksum == 0) ? 1 : checksum; // 0 は「分割全体のチェックサムがない」に使う
+    return checksum_;
+}
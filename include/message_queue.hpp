@@ -1,24 +1,38 @@
 /*
 複数のスレッドから安全にメッセージ（オブジェクト）をキューに追加および取り出すための機能
 マルチスレッド環境で安全に動作するメッセージキューを実装
+容量固定 (MESSAGE_QUEUE_CAPACITY) のロックフリー MPMC リングバッファ (Vyukov 方式) で, 各セルの seq_ で空き/使用中を判定する
+まとめて push / pop するときは連続して使えるセルの範囲を 1 回の CAS で確保する
+キューが空のときだけ eventcount (待機スレッド数 + mutex + 条件変数) で眠り, push 側は待機スレッドがいるときだけ起こす
 
 push メソッド:
 メッセージをキューに追加します。
-キューが空だった場合、他のスレッドに新しいメッセージが追加されたことを通知します。
+キューが満杯の場合は空くまで待ちます (yield しながら再試行)。
+待機しているスレッドがいれば, 新しいメッセージが追加されたことを通知します。
 
 pop メソッド:
-キューからメッセージを全て取り出し、ベクターに格納します。
+キューからメッセージを最大 max_num 個取り出し、ベクターに格納します。
+キューが空の場合は少しスピンしてから, メッセージが入るまで眠ります。
+wait_us を指定すると眠るのはその時間 (μs) までで, メッセージが来なければ 0 を返します。
 取り出したメッセージの数を返します
 
+tryPushBulk メソッド:
+メッセージをまとめてキューに追加します (待たない)。
+満杯で入りきらなかった分はベクターに残し, 追加した数を返します。
+受信スレッドが待たずに RWer を渡すときに使います。
+
+tryPopBulk メソッド:
+キューからメッセージを最大 max_num 個取り出し、ベクターに格納します (待たない)。
+他のスレッドのキューから RWer を盗むときに使います。
+
 getSize メソッド:
-キューのサイズを返します。
+キューのサイズ (概数) を返します。
 
 
 
 */
 #pragma once
 
-#include <queue>
 #include <string>
 #include <mutex>
 #include <condition_variable>
@@ -26,6 +40,9 @@ getSize メソッド:
 #include <unordered_map>
 #include <vector>
 #include <utility>
+#include <atomic>
+#include <thread>
+#include <chrono>
 
 #include "random_walker.hpp"
 #include "graph.hpp"
@@ -39,84 +56,282 @@ struct MessageQueue
 {
 
 public:
-    void push(std::unique_ptr<T> &&message)
+    MessageQueue()
     {
-        { // 排他制御
-            std::lock_guard<std::mutex> lk(mtx_message_queue_);
+        cells_ = new Cell[MESSAGE_QUEUE_CAPACITY];
+        for (uint64_t i = 0; i < MESSAGE_QUEUE_CAPACITY; i++)
+        {
+            cells_[i].seq_.store(i, std::memory_order_relaxed);
+        }
+    }
 
-            bool queue_empty = message_queue_.empty();
+    ~MessageQueue()
+    {
+        T *ptr;
+        while (tryPop(ptr))
+        {
+            delete ptr;
+        }
+        delete[] cells_;
+    }
 
-            message_queue_.push(std::move(message));
+    void push(std::unique_ptr<T> &&message)
+    {
+        T *ptr = message.release();
+        while (!tryPush(ptr))
+        { // 満杯なので空くまで待つ
+            std::this_thread::yield();
+        }
+
+        notify();
+    }
 
-            if (queue_empty)
-            { // 空キューでなくなった通知
-                cv_message_queue_.notify_all();
+    void push(std::vector<std::unique_ptr<T>> &RWer_ptr_vec)
+    {
+        uint32_t vec_size = RWer_ptr_vec.size();
+        uint32_t i = 0;
+        while (i < vec_size)
+        {
+            uint32_t pushed = tryPushBulk(&RWer_ptr_vec[i], vec_size - i);
+            if (pushed == 0)
+            { // 満杯なので空くまで待つ
+                notify();
+                std::this_thread::yield();
             }
+            i += pushed;
         }
+
+        notify();
     }
 
-    void push(std::vector<std::unique_ptr<RandomWalker>> &RWer_ptr_vec)
+    // 入るだけまとめて入れる (待たない, 入りきらなかった分は RWer_ptr_vec に残して入れた数を返す)
+    uint32_t tryPushBulk(std::vector<std::unique_ptr<T>> &RWer_ptr_vec)
     {
-        { // 排他制御
-            std::lock_guard<std::mutex> lk(mtx_message_queue_);
+        uint32_t vec_size = RWer_ptr_vec.size();
+        uint32_t i = 0;
+        while (i < vec_size)
+        {
+            uint32_t pushed = tryPushBulk(&RWer_ptr_vec[i], vec_size - i);
+            if (pushed == 0)
+                break; // 満杯
+            i += pushed;
+        }
+        RWer_ptr_vec.erase(RWer_ptr_vec.begin(), RWer_ptr_vec.begin() + i);
+
+        if (i > 0)
+            notify();
+        return i;
+    }
 
-            bool queue_empty = message_queue_.empty();
+    // message_queue_ から message をまとめて (最大 max_num 個) 取り出す
+    // vector に格納
+    // 入れた数を返す (wait_us > 0 なら wait_us 待っても来なければ 0)
+    uint32_t pop(std::vector<std::unique_ptr<T>> &ptr_vec, const uint32_t &max_num = MESSAGE_QUEUE_CAPACITY, const uint32_t &wait_us = 0)
+    {
+        int spin = 0;
+        bool waited = false;
+        while (true)
+        {
+            uint32_t vec_size = tryPopBulk(ptr_vec, max_num);
+            if (vec_size > 0)
+                return vec_size;
+
+            if (spin < QUEUE_SPIN_NUM)
+            { // すぐに入ってくることが多いので少しだけスピン
+                spin++;
+                continue;
+            }
+            if (waited)
+                return 0; // wait_us 待っても来なかった
+
+            // RWer_Queue が空じゃなくなるまで待機
+            waiters_.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lk(mtx_message_queue_);
+                if (wait_us == 0)
+                    cv_message_queue_.wait(lk, [&]
+                                           { return isReady(); });
+                else
+                    waited = !cv_message_queue_.wait_for(lk, std::chrono::microseconds(wait_us), [&]
+                                                         { return isReady(); });
+            }
+            waiters_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 読み出せるセルを先頭から最大 max_num 個取り出して ptr_vec の末尾に入れる (待たない, 取り出した数を返す)
+    uint32_t tryPopBulk(std::vector<std::unique_ptr<T>> &ptr_vec, const uint32_t &max_num = MESSAGE_QUEUE_CAPACITY)
+    {
+        uint64_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            // pos から連続して読み出せるセルの数を数える
+            uint32_t count = 0;
+            while (count < max_num)
+            {
+                Cell &cell = cells_[(pos + count) & (MESSAGE_QUEUE_CAPACITY - 1)];
+                if (cell.seq_.load(std::memory_order_acquire) != pos + count + 1)
+                    break;
+                count++;
+            }
 
-            uint32_t vec_size = RWer_ptr_vec.size();
-            for (int i = 0; i < vec_size; i++)
+            if (count == 0)
             {
-                message_queue_.push(std::move(RWer_ptr_vec[i]));
+                Cell &cell = cells_[pos & (MESSAGE_QUEUE_CAPACITY - 1)];
+                if ((int64_t)cell.seq_.load(std::memory_order_acquire) - (int64_t)(pos + 1) < 0)
+                    return 0; // 空
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+                continue;
             }
 
-            if (queue_empty)
-            { // 空キューでなくなった通知
-                cv_message_queue_.notify_all();
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+            {
+                ptr_vec.reserve(ptr_vec.size() + count);
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    Cell &cell = cells_[(pos + i) & (MESSAGE_QUEUE_CAPACITY - 1)];
+                    ptr_vec.emplace_back(cell.data_);
+                    cell.seq_.store(pos + i + MESSAGE_QUEUE_CAPACITY, std::memory_order_release);
+                }
+                return count;
             }
         }
     }
 
-    // message_queue_ から message をまとめて取り出す
-    // vector に格納
-    // 入れた数を返す
-    uint32_t pop(std::vector<std::unique_ptr<T>> &ptr_vec)
+    // message_queue_ のサイズを入手
+    uint32_t getSize()
     {
-        { // 排他制御
-            std::unique_lock<std::mutex> lk(mtx_message_queue_);
+        uint64_t dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+        uint64_t enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+        return (enqueue_pos > dequeue_pos) ? enqueue_pos - dequeue_pos : 0;
+    }
 
-            // RWer_Queue が空じゃなくなるまで待機
-            cv_message_queue_.wait(lk, [&]
-                                   { return !message_queue_.empty(); });
+private:
+    // リングバッファのセル
+    // seq_ == pos なら位置 pos に書き込める, seq_ == pos + 1 なら位置 pos から読み出せる
+    struct Cell
+    {
+        std::atomic<uint64_t> seq_;
+        T *data_;
+    };
+
+    // pop 側が眠る前にスピンする回数
+    static const int QUEUE_SPIN_NUM = 256;
+
+    // 1 個入れる (満杯なら false)
+    bool tryPush(T *ptr)
+    {
+        uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = cells_[pos & (MESSAGE_QUEUE_CAPACITY - 1)];
+            int64_t diff = (int64_t)cell.seq_.load(std::memory_order_acquire) - (int64_t)pos;
+            if (diff == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.data_ = ptr;
+                    cell.seq_.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // 満杯
+            else
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    // 先頭から最大 num 個を入れる (入れた数を返す)
+    uint32_t tryPushBulk(std::unique_ptr<T> *ptrs, const uint32_t &num)
+    {
+        uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            // pos から連続して書き込めるセルの数を数える
+            uint32_t count = 0;
+            while (count < num)
+            {
+                Cell &cell = cells_[(pos + count) & (MESSAGE_QUEUE_CAPACITY - 1)];
+                if (cell.seq_.load(std::memory_order_acquire) != pos + count)
+                    break;
+                count++;
+            }
 
-            uint32_t vec_size = message_queue_.size();
-            ptr_vec.reserve(vec_size);
+            if (count == 0)
+            {
+                Cell &cell = cells_[pos & (MESSAGE_QUEUE_CAPACITY - 1)];
+                if ((int64_t)cell.seq_.load(std::memory_order_acquire) - (int64_t)pos < 0)
+                    return 0; // 満杯
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+                continue;
+            }
 
-            while (message_queue_.size())
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
             {
-                std::unique_ptr<T> ptr = std::move(message_queue_.front());
-                message_queue_.pop();
-                ptr_vec.push_back(std::move(ptr));
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    Cell &cell = cells_[(pos + i) & (MESSAGE_QUEUE_CAPACITY - 1)];
+                    cell.data_ = ptrs[i].release();
+                    cell.seq_.store(pos + i + 1, std::memory_order_release);
+                }
+                return count;
             }
+        }
+    }
 
-            return vec_size;
+    // 1 個取り出す (空なら false)
+    bool tryPop(T *&ptr)
+    {
+        uint64_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = cells_[pos & (MESSAGE_QUEUE_CAPACITY - 1)];
+            int64_t diff = (int64_t)cell.seq_.load(std::memory_order_acquire) - (int64_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    ptr = cell.data_;
+                    cell.seq_.store(pos + MESSAGE_QUEUE_CAPACITY, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // 空
+            else
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
         }
     }
 
-    // message_queue_ のサイズを入手
-    uint32_t getSize()
+    // 先頭のセルが読み出せる状態か
+    bool isReady()
     {
-        { // 排他制御
-            std::lock_guard<std::mutex> lk(mtx_message_queue_);
+        uint64_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        return cells_[pos & (MESSAGE_QUEUE_CAPACITY - 1)].seq_.load(std::memory_order_acquire) == pos + 1;
+    }
 
-            return message_queue_.size();
+    // 眠っている pop 側がいれば起こす
+    void notify()
+    {
+        // push したセルの公開と waiters_ の読み出しの順序を保証 (pop 側の waiters_ 加算 -> isReady と対になる)
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lk(mtx_message_queue_);
+            cv_message_queue_.notify_all();
         }
     }
 
-private:
-    std::queue<std::unique_ptr<T>> message_queue_;
+    Cell *cells_;
+    alignas(64) std::atomic<uint64_t> enqueue_pos_{0};
+    alignas(64) std::atomic<uint64_t> dequeue_pos_{0};
+    alignas(64) std::atomic<uint32_t> waiters_{0};
     std::mutex mtx_message_queue_;
     std::condition_variable cv_message_queue_;
 };
 
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+//////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,153 @@
+/*
+終了した RWer を (起点, 終点) ごとに数えて Personalized PageRank (PPR) を推定する
+RWer は確率 ALPHA で終了する (歩数が幾何分布) ので, 起点 s から出た RWer の終点の分布が s の PPR ベクトルになる
+PPR_VISIT_ALL_FLAG が true なら終点だけでなく経路上の全ての頂点を数える (訪問回数も PPR に比例する)
+RWer は必ず起点サーバで終了が記録されるので, 各サーバは自サーバの頂点を起点とする PPR ベクトルを完全に持つ (サーバ間の集約は不要)
+
+カウンタは walkEngine スレッドごとのシャードに分けて持ち, 書き出すときにまとめる
+
+init メソッド:
+スレッド数分のシャードを用意します。
+
+addRWer メソッド:
+起点 source_node の RWer の終点 (または経路上の全頂点) を数えます。
+
+dump メソッド:
+シャードをまとめて起点ごとに正規化し, 上位 PPR_TOP_K 個 (0 なら全て) を path に書き出してカウンタを空にします。書き出した起点の数を返します。
+出力は 1 行 1 起点で, "起点 頂点:推定値 頂点:推定値 ..." (推定値の大きい順) です。
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+
+#include "type.hpp"
+#include "random_walker.hpp"
+#include "../config/param.hpp"
+
+class PPRAggregator
+{
+
+public:
+    // スレッド数分のシャードを用意
+    void init(const uint32_t &shard_num);
+
+    // 起点 source_node の RWer の終点 (または経路上の全頂点) を数える
+    void addRWer(const vertex_id_t &source_node, RandomWalker &RWer);
+
+    // 起点ごとの推定値をファイルに書き出して, カウンタを空にする
+    uint64_t dump(const std::string &path);
+
+private:
+    typedef std::unordered_map<vertex_id_t, std::unordered_map<vertex_id_t, uint32_t>> CountMap; // 起点 -> (頂点 -> 回数)
+
+    struct Shard
+    {
+        std::mutex mtx; // 基本的にスレッド専用なので競合しない (スレッド数がシャード数を超えたときと dump のため)
+        CountMap counts;
+    };
+
+    // 呼び出したスレッドのシャードを入手
+    Shard &getShard();
+
+    std::unique_ptr<Shard[]> shards_;
+    uint32_t shard_num_ = 0;
+    std::atomic<uint32_t> next_shard_{0}; // 次にスレッドに割り当てるシャード
+};
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+inline void PPRAggregator::init(const uint32_t &shard_num)
+{
+    shard_num_ = shard_num;
+    shards_.reset(new Shard[shard_num]);
+}
+
+inline PPRAggregator::Shard &PPRAggregator::getShard()
+{
+    thread_local uint32_t shard_id = next_shard_++;
+    return shards_[shard_id % shard_num_];
+}
+
+inline void PPRAggregator::addRWer(const vertex_id_t &source_node, RandomWalker &RWer)
+{
+    Shard &shard = getShard();
+    std::lock_guard<std::mutex> lk(shard.mtx);
+    std::unordered_map<vertex_id_t, uint32_t> &counts = shard.counts[source_node];
+
+    if (!PPR_VISIT_ALL_FLAG)
+    {
+        counts[RWer.getCurrentNodeID()]++;
+        return;
+    }
+
+    // path: (頂点, ホストID, 次数, indexuv, indexvu), (), (), ...
+    uint16_t path_length = 0;
+    std::vector<uint64_t> path;
+    RWer.getPath(path_length, path);
+    for (uint16_t i = 0; i < path_length; i++)
+        counts[path[i * 5]]++;
+}
+
+inline uint64_t PPRAggregator::dump(const std::string &path)
+{
+    // シャードを 1 つにまとめる
+    CountMap merged;
+    for (uint32_t i = 0; i < shard_num_; i++)
+    {
+        std::lock_guard<std::mutex> lk(shards_[i].mtx);
+        if (merged.empty())
+        {
+            merged.swap(shards_[i].counts);
+            continue;
+        }
+        for (auto &[source_node, counts] : shards_[i].counts)
+        {
+            std::unordered_map<vertex_id_t, uint32_t> &merged_counts = merged[source_node];
+            for (auto &[node_id, count] : counts)
+                merged_counts[node_id] += count;
+        }
+        CountMap().swap(shards_[i].counts);
+    }
+
+    FILE *f = fopen(path.c_str(), "w");
+    if (f == NULL)
+    {
+        perror("fopen ppr");
+        exit(1); // 異常終了
+    }
+
+    std::vector<std::pair<uint32_t, vertex_id_t>> ranking; // (回数, 頂点)
+    for (auto &[source_node, counts] : merged)
+    {
+        uint64_t count_sum = 0;
+        ranking.clear();
+        for (auto &[node_id, count] : counts)
+        {
+            ranking.emplace_back(count, node_id);
+            count_sum += count;
+        }
+
+        // 回数の多い順に上位 PPR_TOP_K 個だけ残す
+        size_t top_k = (PPR_TOP_K == 0) ? ranking.size() : std::min<size_t>(PPR_TOP_K, ranking.size());
+        std::partial_sort(ranking.begin(), ranking.begin() + top_k, ranking.end(), std::greater<std::pair<uint32_t, vertex_id_t>>());
+
+        fprintf(f, "%lu", (uint64_t)source_node);
+        for (size_t i = 0; i < top_k; i++)
+            fprintf(f, " %lu:%.6g", (uint64_t)ranking[i].second, (double)ranking[i].first / count_sum);
+        fprintf(f, "\n");
+    }
+    fclose(f);
+
+    return merged.size();
+}
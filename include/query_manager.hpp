@@ -0,0 +1,139 @@
+/*
+オンラインの PPR クエリ (1 つの起点からの PPR) の管理
+クエリごとに query_id を振り, そのクエリの RWer (query_id 付き) の終点を数える
+RWer は必ず起点サーバに戻ってきて終了が記録されるので, 起点の持ち主のサーバだけでクエリが完結する
+複数のクエリが同時に走っていても, query_id ごとに別々に数える
+
+registerQuery メソッド:
+RWer_num 個の RWer を出すクエリを登録し, query_id (0 以外) を返します。
+
+addRWer メソッド:
+クエリの RWer の終点を数えます。RWer_num 個揃ったら waitResult で待っているスレッドを起こします。
+既に消えたクエリ (タイムアウトしたもの) の RWer は無視します。
+
+waitResult メソッド:
+クエリの RWer が全て終了するまで (最大 timeout_ms) 待ち, 終点の回数の多い順に上位 top_k 個の (頂点, 推定値) を result に入れて, クエリを消します。
+全て揃わずにタイムアウトした場合は, それまでに終了した RWer だけで推定して false を返します。
+
+クエリのメッセージ (TCP, QUERY_PORT):
+要求: ver_id (1B, QUERY), 起点 (8B), RWer 数 (4B), 上位何個返すか (4B)
+応答: ver_id (1B, QUERY), query_id (4B, 起点が自サーバの頂点でなければ 0), 全ての RWer が戻ってきたか (1B), 処理時間 (8B, s), 頂点数 (4B),
+      {頂点 (8B), 推定値 (8B)} * 頂点数
+*/
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+#include "type.hpp"
+#include "../config/param.hpp"
+
+// クエリのメッセージの長さ
+const uint32_t QUERY_REQUEST_LENGTH = 17;
+const uint32_t QUERY_RESPONSE_HEADER_LENGTH = 18;
+const uint32_t QUERY_RESPONSE_ENTRY_LENGTH = 16;
+
+class QueryManager
+{
+
+public:
+    // クエリを登録して query_id を入手
+    uint32_t registerQuery(const uint32_t &RWer_num);
+
+    // クエリの RWer の終点を数える
+    void addRWer(const uint32_t &query_id, const vertex_id_t &end_node);
+
+    // クエリの RWer が全て終了するまで待ち, 上位 top_k 個の (頂点, 推定値) を入手してクエリを消す (タイムアウトしたら false)
+    bool waitResult(const uint32_t &query_id, const uint32_t &top_k, const uint32_t &timeout_ms, std::vector<std::pair<vertex_id_t, double>> &result);
+
+private:
+    struct Query
+    {
+        uint32_t RWer_num;
+        uint32_t end_count = 0;
+        std::unordered_map<vertex_id_t, uint32_t> counts; // 終点 -> 回数
+        std::mutex mtx;
+        std::condition_variable cv;
+    };
+
+    std::unordered_map<uint32_t, std::shared_ptr<Query>> queries_; // query_id -> クエリ
+    uint32_t next_query_id_ = 1;
+    std::shared_mutex mtx_queries_;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+inline uint32_t QueryManager::registerQuery(const uint32_t &RWer_num)
+{
+    std::shared_ptr<Query> query = std::make_shared<Query>();
+    query->RWer_num = RWer_num;
+
+    std::unique_lock<std::shared_mutex> lk(mtx_queries_);
+    uint32_t query_id = next_query_id_++;
+    if (next_query_id_ == 0) // 0 はクエリでない RWer の印なので飛ばす
+        next_query_id_ = 1;
+    queries_[query_id] = query;
+    return query_id;
+}
+
+inline void QueryManager::addRWer(const uint32_t &query_id, const vertex_id_t &end_node)
+{
+    std::shared_ptr<Query> query;
+    {
+        std::shared_lock<std::shared_mutex> lk(mtx_queries_);
+        auto it = queries_.find(query_id);
+        if (it == queries_.end())
+            return; // タイムアウトして消えたクエリ
+        query = it->second;
+    }
+
+    std::lock_guard<std::mutex> lk(query->mtx);
+    query->counts[end_node]++;
+    if (++query->end_count == query->RWer_num)
+        query->cv.notify_all();
+}
+
+inline bool QueryManager::waitResult(const uint32_t &query_id, const uint32_t &top_k, const uint32_t &timeout_ms, std::vector<std::pair<vertex_id_t, double>> &result)
+{
+    std::shared_ptr<Query> query;
+    {
+        std::shared_lock<std::shared_mutex> lk(mtx_queries_);
+        query = queries_.at(query_id);
+    }
+
+    bool completed;
+    std::vector<std::pair<uint32_t, vertex_id_t>> ranking; // (回数, 頂点)
+    uint32_t end_count;
+    {
+        std::unique_lock<std::mutex> lk(query->mtx);
+        completed = query->cv.wait_for(lk, std::chrono::milliseconds(timeout_ms), [&]
+                                       { return query->end_count >= query->RWer_num; });
+        for (auto &[node_id, count] : query->counts)
+            ranking.emplace_back(count, node_id);
+        end_count = query->end_count;
+    }
+
+    // これ以降に戻ってきた RWer は無視する
+    {
+        std::unique_lock<std::shared_mutex> lk(mtx_queries_);
+        queries_.erase(query_id);
+    }
+
+    size_t result_num = std::min<size_t>(top_k, ranking.size());
+    std::partial_sort(ranking.begin(), ranking.begin() + result_num, ranking.end(), std::greater<std::pair<uint32_t, vertex_id_t>>());
+    result.clear();
+    for (size_t i = 0; i < result_num; i++)
+        result.emplace_back(ranking[i].second, (double)ranking[i].first / end_count);
+
+    return completed;
+}
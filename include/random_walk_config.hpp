@@ -11,12 +11,22 @@ getAlpha メソッド:
 getRWerLife メソッド:
 ランダムウォーカーの寿命を取得します。
 乱数生成器を使って、ランダムウォーカーが終了確率αに基づいて何ステップ進むかを決定します。
+歩数は幾何分布 P(life = k) = (1-α)^(k-1) α に従うので, 逆関数法で乱数 1 回から求めます。
+node2vec の RW (NODE2VEC_FLAG) では歩数は NODE2VEC_WALK_LENGTH で固定です。
+
+getNode2vecAcceptRate メソッド:
+node2vec の棄却サンプリングで, 候補の頂点を受理する確率を返します。
+一歩前の頂点からの距離 (0: 一歩前の頂点そのもの, 1: 一歩前の頂点の隣接頂点, 2: それ以外) に対して
+重み 1/p, 1, 1/q をその最大値で割ったものです。
 
 
 */
 #pragma once
 
 #include <random>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 
 #include "util.hpp"
 #include "../config/param.hpp"
@@ -41,9 +51,19 @@ public:
     // α の値から
     uint16_t getRWerLife(StdRandNumGenerator &gen);
 
+    // node2vec で一歩前の頂点からの距離が distance (0, 1, 2) の候補を受理する確率
+    double getNode2vecAcceptRate(const uint8_t &distance);
+
 private:
-    uint32_t number_of_RW_execution_ = 10000; // RW の実行回数
-    double alpha_ = ALPHA;                    // RW の終了確率
+    uint32_t number_of_RW_execution_ = 10000;            // RW の実行回数
+    double alpha_ = ALPHA;                               // RW の終了確率
+    double log_one_minus_alpha_ = std::log(1.0 - ALPHA); // log(1 - α) (歩数の生成用)
+
+    // node2vec の受理確率 {1/p, 1, 1/q} / max(1/p, 1, 1/q)
+    double node2vec_accept_rate_[3] = {
+        (1.0 / NODE2VEC_P) / std::max({1.0 / NODE2VEC_P, 1.0, 1.0 / NODE2VEC_Q}),
+        1.0 / std::max({1.0 / NODE2VEC_P, 1.0, 1.0 / NODE2VEC_Q}),
+        (1.0 / NODE2VEC_Q) / std::max({1.0 / NODE2VEC_P, 1.0, 1.0 / NODE2VEC_Q})};
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -67,8 +87,18 @@ inline double RandomWalkConfig::getAlpha()
 
 inline uint16_t RandomWalkConfig::getRWerLife(StdRandNumGenerator &gen)
 {
-    uint16_t life = 1;
-    while (gen.gen_float(1.0) > alpha_)
-        life++;
+    if (NODE2VEC_FLAG)
+        return NODE2VEC_WALK_LENGTH;
+
+    // life = 1 + floor(log(U) / log(1 - α)), U は (0, 1] の一様乱数
+    double u = 1.0 - gen.gen_double();
+    double life = 1.0 + std::floor(std::log(u) / log_one_minus_alpha_);
+    if (!(life < std::numeric_limits<uint16_t>::max()))
+        return std::numeric_limits<uint16_t>::max();
     return life;
 }
+
+inline double RandomWalkConfig::getNode2vecAcceptRate(const uint8_t &distance)
+{
+    return node2vec_accept_rate_[distance];
+}
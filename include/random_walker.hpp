@@ -13,8 +13,10 @@ RandomWalker という構造体を定義
 #include <iostream>
 #include <bitset>
 #include <cstring>
+#include <algorithm>
 
 #include "../config/param.hpp"
+#include "random_walker_pool.hpp"
 
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
@@ -25,7 +27,8 @@ RandomWalker という構造体を定義
 // メッセージ ID について, 0 -> 生存した RWer, 1 -> 終了した RWer, 2 -> 複数の RWer が入っているパケット, 3 -> 実験開始の合図, 4 -> 実験終了の合図
 //
 // flag_ (8bit):
-// 一歩前で通信が発生したか: 1bit, next_index に値が入っているか: 1bit, 全体を通して通信が発生したか: 1bit, あまり : 5bit
+// 一歩前で通信が発生したか: 1bit, next_index に値が入っているか: 1bit, 全体を通して通信が発生したか: 1bit,
+// 一歩前の頂点の隣接スケッチを持っているか (node2vec 用): 1bit, あまり : 4bit
 //
 // RWer_size_ (16bit):
 // RWer 単体のメモリサイズ
@@ -38,11 +41,14 @@ RandomWalker という構造体を定義
 // path_length_at_current_host_ (16bit):
 // RWer の現在の同一ホスト内の経路長
 //
-// reserved_ (32bit):
-// 予備
+// query_id_ (32bit):
+// オンラインの PPR クエリの ID (0 ならクエリの RWer ではない)
 //
 // next_index_ (64bit):
-// 通信が発生した時の次の遷移先 index
+// 他サーバに送られた回数 (16bit, ホップ数) + 通信が発生した時の次の遷移先 index (48bit)
+//
+// (flag_ の隣接スケッチのビットが立っているときだけ) prev_node_ (64bit), prev_sketch_ (64bit * NODE2VEC_SKETCH_WORDS):
+// 一歩前の頂点 (他サーバの頂点) とその隣接頂点集合の Bloom filter. RWer_size_ には含めず, メッセージではヘッダと path_ の間に入る
 //
 // path_ (64bit の可変長配列):
 // 経路情報
@@ -62,14 +68,65 @@ RandomWalker(const uint32_t dummy):
 ダミー RWer を作成します。メッセージIDを「ダミー」に設定します。
 なぜダミーが必要なのか？
 
+operator new / operator delete:
+RWer 本体は FixedBlockPool (スレッドごとの空きリスト) から確保・解放します。
+new RandomWalker(...) も std::make_unique<RandomWalker>(...) も, unique_ptr による破棄もそのままプールを使います。
+プールのブロックは sizeof(RandomWalker) なので, 大きさの違う確保 (派生クラスなど) は通常の operator new / delete に回します。
+path_ は PATH_INLINE_SIZE 以下なら RWer 内の領域 (PathBuffer) に入るので, 通常は 1 RWer あたりのヒープ確保はありません。
+
+setPrevSketch() / addPrevSketch() / mayBePrevNeighbour() / clearPrevSketch():
+node2vec の RW で, 一歩前の頂点が他サーバにあるときに使う隣接スケッチ (Bloom filter) を扱います。
+一歩前の頂点のサーバが送信前に隣接頂点を全て addPrevSketch で登録し, 受け取ったサーバは mayBePrevNeighbour で隣接判定をします。
+偽陽性 (隣接していないのに true) はありますが, 偽陰性はありません。
+
+compactPath():
+path_ を {起点 HostID(長さ 0)}, {現在の HostID(長さ 1)}, (現在頂点) だけに縮めます。
+経路情報が不要なとき (キャッシュ学習をしていないとき) に送信前に呼ぶと, 送信サイズが歩数に依存しなくなります。
+現在頂点のホストが起点と同じ場合は {起点 HostID(長さ 1)}, (現在頂点) になります。
+
+addHop() / getHopNum():
+RWer が他サーバに送られた回数 (終了後に起点サーバへ戻る分も含む) を数えます。next_index_ の上位 16bit に入れるので, メッセージの大きさは変わりません。
+
 */
 
+// path_ の格納領域
+// PATH_INLINE_SIZE 以下なら RWer 内に持ち, 超えたときだけヒープに移す
+class PathBuffer
+{
+
+public:
+    PathBuffer() = default;
+    PathBuffer(const PathBuffer &) = delete; // data_ が自身の inline_ を指すのでコピー禁止
+    PathBuffer &operator=(const PathBuffer &) = delete;
+
+    // 内容を保持したまま長さを変える (増えた部分は初期化しない)
+    void resize(const uint32_t &size);
+
+    uint64_t &operator[](const uint32_t &i);
+
+    // 先頭ポインタを入手
+    uint64_t *data();
+
+    // 長さを入手
+    uint32_t size();
+
+private:
+    uint64_t *data_ = inline_;
+    uint32_t size_ = 0;
+    std::vector<uint64_t> heap_;
+    uint64_t inline_[PATH_INLINE_SIZE];
+};
+
 // TODO' RWerの構造をいじりたいときにはここら辺を編集するのか
 
 struct RandomWalker
 {
 
 public:
+    // RWer 本体はプールから確保
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     // コンストラクタ
     RandomWalker();
     RandomWalker(const uint64_t &source_node, const uint64_t &node_degree, const uint32_t &RWer_id, const uint64_t &HostID, const uint32_t &RWer_life);
@@ -85,7 +142,7 @@ public:
     // RWer の ID を入手
     uint32_t getRWerID();
 
-    // RWer のサイズを入手 (Byte 単位)
+    // RWer のサイズを入手 (Byte 単位, 送信時のサイズ)
     uint32_t getRWerSize();
 
     // RWer が終了しているかどうか (true: 終了, false: 生存)
@@ -145,6 +202,36 @@ public:
     // 起点サーバの HostIDを入手
     uint64_t getHostID();
 
+    // クエリの ID を入力
+    void setQueryID(const uint32_t &query_id);
+
+    // クエリの ID を入手 (0 ならクエリの RWer ではない)
+    uint32_t getQueryID();
+
+    // 他サーバに送られた回数を 1 増やす (上限 65535)
+    void addHop();
+
+    // 他サーバに送られた回数を入手
+    uint16_t getHopNum();
+
+    // 一歩前の頂点の隣接スケッチを空にして持たせる (node2vec 用)
+    void setPrevSketch(const uint64_t &prev_node);
+
+    // 一歩前の頂点の隣接頂点を隣接スケッチに登録
+    void addPrevSketch(const uint64_t &node_id);
+
+    // 一歩前の頂点の隣接スケッチを持っているか
+    bool hasPrevSketch();
+
+    // 隣接スケッチの一歩前の頂点を入手
+    uint64_t getPrevSketchNode();
+
+    // 隣接スケッチで node_id が一歩前の頂点に隣接しているか判定 (偽陽性あり)
+    bool mayBePrevNeighbour(const uint64_t &node_id);
+
+    // 隣接スケッチを捨てる
+    void clearPrevSketch();
+
     // RWer の現在頂点を更新
     void updateRWer(const uint64_t &next_node, const uint64_t &host_id, const uint64_t &node_degree, const uint64_t &index_uv, const uint64_t &index_vu);
 
@@ -154,6 +241,9 @@ public:
     // RWer を終了させる
     void endRWer();
 
+    // path_ を起点 HostID と現在頂点だけに縮める (送信サイズ削減用)
+    void compactPath();
+
     // message に RWer のデータを書き込む
     void writeMessage(char *message);
 
@@ -167,21 +257,82 @@ public:
     void printRWer();
 
 private:
+    // 隣接スケッチの i 番目のハッシュ値 (ビット位置)
+    static uint32_t sketchBit(const uint64_t &node_id, const uint32_t &i);
+
+    // 隣接スケッチの大きさ (Byte)
+    static const uint32_t PREV_SKETCH_SIZE = 8 + 8 * NODE2VEC_SKETCH_WORDS;
+
+    // next_index_ のうち index の部分 (下位 48bit)
+    static const uint64_t NEXT_INDEX_MASK = ((uint64_t)1 << 48) - 1;
+
     uint8_t ver_id_ = 0;
     uint8_t flag_ = 0;
     uint16_t RWer_size_ = 0;
     uint32_t RWer_id_ = 0;
     uint16_t RWer_life_ = 0;
     uint16_t path_length_at_current_host_ = 0;
-    uint32_t reserved_ = 0;
-    uint64_t next_index_ = 0;
-    std::vector<uint64_t> path_;
+    uint32_t query_id_ = 0;
+    uint64_t next_index_ = 0; // 上位 16bit はホップ数
+    uint64_t prev_node_ = 0;
+    uint64_t prev_sketch_[NODE2VEC_SKETCH_WORDS];
+    PathBuffer path_;
 };
 
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
+inline void PathBuffer::resize(const uint32_t &size)
+{
+    if (size > PATH_INLINE_SIZE || data_ != inline_)
+    {
+        if (data_ == inline_)
+        { // RWer 内の領域からヒープに移す
+            heap_.resize(size);
+            memcpy(heap_.data(), inline_, sizeof(uint64_t) * std::min(size_, size));
+        }
+        else
+        {
+            heap_.resize(size);
+        }
+        data_ = heap_.data();
+    }
+    size_ = size;
+}
+
+inline uint64_t &PathBuffer::operator[](const uint32_t &i)
+{
+    return data_[i];
+}
+
+inline uint64_t *PathBuffer::data()
+{
+    return data_;
+}
+
+inline uint32_t PathBuffer::size()
+{
+    return size_;
+}
+
+inline void *RandomWalker::operator new(size_t size)
+{
+    if (size != sizeof(RandomWalker))
+        return ::operator new(size);
+    return FixedBlockPool<sizeof(RandomWalker)>::allocate();
+}
+
+inline void RandomWalker::operator delete(void *ptr, size_t size)
+{
+    if (size != sizeof(RandomWalker))
+    {
+        ::operator delete(ptr);
+        return;
+    }
+    FixedBlockPool<sizeof(RandomWalker)>::deallocate(ptr);
+}
+
 inline RandomWalker::RandomWalker()
 {
     setMessageID(ALIVE);
@@ -229,21 +380,22 @@ inline RandomWalker::RandomWalker(const char *message)
     idx += 2;
     path_length_at_current_host_ = *(uint16_t *)(message + idx);
     idx += 2;
-    reserved_ = *(uint32_t *)(message + idx);
+    query_id_ = *(uint32_t *)(message + idx);
     idx += 4;
     next_index_ = *(uint64_t *)(message + idx);
     idx += 8;
+    if (hasPrevSketch())
+    {
+        memcpy(&prev_node_, message + idx, sizeof(uint64_t));
+        memcpy(prev_sketch_, message + idx + sizeof(uint64_t), sizeof(prev_sketch_));
+        idx += PREV_SKETCH_SIZE;
+    }
 
     // debug
     // std::cout << "getRequiredPathSize() = " << getRequiredPathSize() << std::endl;
 
     path_.resize(getRequiredPathSize());
-    int last_idx = getNextIndexOfPath() - 1;
-    for (int i = 0; i <= last_idx; i++)
-    {
-        path_[i] = *(uint64_t *)(message + idx);
-        idx += 8;
-    }
+    memcpy(path_.data(), message + idx, sizeof(uint64_t) * getNextIndexOfPath());
 }
 
 inline RandomWalker::RandomWalker(const uint32_t dummy)
@@ -269,7 +421,7 @@ inline uint32_t RandomWalker::getRWerID()
 
 inline uint32_t RandomWalker::getRWerSize()
 {
-    return RWer_size_;
+    return hasPrevSketch() ? RWer_size_ + PREV_SKETCH_SIZE : RWer_size_;
 }
 
 inline bool RandomWalker::isEnd()
@@ -311,7 +463,7 @@ inline void RandomWalker::setNextIndexFlag(bool flag)
 
 inline void RandomWalker::setNextIndex(const uint64_t &index_num)
 {
-    next_index_ = index_num;
+    next_index_ = (next_index_ & ~NEXT_INDEX_MASK) | (index_num & NEXT_INDEX_MASK); // ホップ数は残す
     setNextIndexFlag(true);
 }
 
@@ -323,7 +475,7 @@ inline uint64_t RandomWalker::getNextIndex()
         exit(1);
     }
     setNextIndexFlag(false);
-    return next_index_;
+    return next_index_ & NEXT_INDEX_MASK;
 }
 
 inline uint64_t RandomWalker::getCurrentHostIndex()
@@ -400,6 +552,79 @@ inline uint64_t RandomWalker::getHostID()
     return (path_[0] >> 16);
 }
 
+inline void RandomWalker::setQueryID(const uint32_t &query_id)
+{
+    query_id_ = query_id;
+}
+
+inline uint32_t RandomWalker::getQueryID()
+{
+    return query_id_;
+}
+
+inline void RandomWalker::addHop()
+{
+    if (getHopNum() != UINT16_MAX)
+        next_index_ += (uint64_t)1 << 48;
+}
+
+inline uint16_t RandomWalker::getHopNum()
+{
+    return next_index_ >> 48;
+}
+
+inline void RandomWalker::setPrevSketch(const uint64_t &prev_node)
+{
+    flag_ |= (1 << 4);
+    prev_node_ = prev_node;
+    memset(prev_sketch_, 0, sizeof(prev_sketch_));
+}
+
+inline uint32_t RandomWalker::sketchBit(const uint64_t &node_id, const uint32_t &i)
+{
+    // splitmix64 の混ぜ方で i ごとに別のハッシュ値を作る
+    uint64_t z = node_id + (i + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return z % (64 * NODE2VEC_SKETCH_WORDS);
+}
+
+inline void RandomWalker::addPrevSketch(const uint64_t &node_id)
+{
+    for (uint32_t i = 0; i < NODE2VEC_SKETCH_HASH_NUM; i++)
+    {
+        uint32_t bit = sketchBit(node_id, i);
+        prev_sketch_[bit / 64] |= (uint64_t)1 << (bit % 64);
+    }
+}
+
+inline bool RandomWalker::hasPrevSketch()
+{
+    return (flag_ >> 4) & 1;
+}
+
+inline uint64_t RandomWalker::getPrevSketchNode()
+{
+    return prev_node_;
+}
+
+inline bool RandomWalker::mayBePrevNeighbour(const uint64_t &node_id)
+{
+    for (uint32_t i = 0; i < NODE2VEC_SKETCH_HASH_NUM; i++)
+    {
+        uint32_t bit = sketchBit(node_id, i);
+        if (((prev_sketch_[bit / 64] >> (bit % 64)) & 1) == 0)
+            return false;
+    }
+    return true;
+}
+
+inline void RandomWalker::clearPrevSketch()
+{
+    flag_ &= ~(1 << 4);
+}
+
 inline void RandomWalker::updateRWer(const uint64_t &next_node, const uint64_t &host_id, const uint64_t &node_degree, const uint64_t &index_uv, const uint64_t &index_vu)
 {
     uint32_t start_index = getNextIndexOfPath();
@@ -448,6 +673,32 @@ inline void RandomWalker::endRWer()
     setMessageID(DEAD);
 }
 
+inline void RandomWalker::compactPath()
+{
+    uint32_t current_index = getCurrentIndexOfPath();
+    uint32_t current_host_index = getCurrentHostIndex();
+    uint64_t host_mask = ~(((uint64_t)1 << 16) - 1);
+    uint32_t start_index;
+
+    if (current_host_index == 0)
+    { // 現在頂点が起点ホストのブロックにある
+        path_[0] = (path_[0] & host_mask) + (1 << 1) + (path_[0] & 1);
+        start_index = 1;
+    }
+    else
+    { // 起点ホスト (長さ 0), 現在のホスト (長さ 1)
+        path_[1] = (path_[current_host_index] & host_mask) + (1 << 1) + (path_[current_host_index] & 1);
+        path_[0] = (path_[0] & host_mask) + (path_[0] & 1);
+        start_index = 2;
+    }
+
+    if (current_index != start_index)
+        memmove(&path_[start_index], &path_[current_index], sizeof(uint64_t) * 4);
+
+    path_length_at_current_host_ = 1;
+    RWer_size_ = 8 + 8 + 8 + (start_index + 4) * 8;
+}
+
 inline void RandomWalker::writeMessage(char *message)
 {
     int idx = 0;
@@ -463,18 +714,19 @@ inline void RandomWalker::writeMessage(char *message)
     idx += sizeof(uint16_t);
     memcpy(message + idx, &path_length_at_current_host_, sizeof(uint16_t));
     idx += sizeof(uint16_t);
-    memcpy(message + idx, &reserved_, sizeof(uint32_t));
+    memcpy(message + idx, &query_id_, sizeof(uint32_t));
     idx += sizeof(uint32_t);
     memcpy(message + idx, &next_index_, sizeof(uint64_t));
     idx += sizeof(uint64_t);
-
-    int i = 0;
-    while (idx < RWer_size_)
+    uint32_t path_pos = idx; // RWer_size_ は隣接スケッチを含まないので path_ の位置は別に持つ
+    if (hasPrevSketch())
     {
-        memcpy(message + idx, &path_[i], sizeof(uint64_t));
-        idx += sizeof(uint64_t);
-        i++;
+        memcpy(message + path_pos, &prev_node_, sizeof(uint64_t));
+        memcpy(message + path_pos + sizeof(uint64_t), prev_sketch_, sizeof(prev_sketch_));
+        path_pos += PREV_SKETCH_SIZE;
     }
+
+    memcpy(message + path_pos, path_.data(), RWer_size_ - idx);
 }
 
 inline void RandomWalker::getHostIDAndLengthInPath(const uint64_t &data, uint64_t &host_id, uint16_t &length)
@@ -515,7 +767,7 @@ inline void RandomWalker::printRWer()
     std::cout << "RWer_id_: " << RWer_id_ << std::endl;
     std::cout << "RWer_life_: " << RWer_life_ << std::endl;
     std::cout << "path_length_at_current_host_: " << path_length_at_current_host_ << std::endl;
-    std::cout << "reserved_: " << reserved_ << std::endl;
+    std::cout << "query_id_: " << query_id_ << std::endl;
     std::cout << "next_index_: " << next_index_ << std::endl;
     uint16_t path__length = (RWer_size_ - 8 - 8 - 8) / 8;
     std::cout << "path__length: " << path__length << std::endl;
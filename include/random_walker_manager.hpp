@@ -23,9 +23,26 @@
 ノードIDの設定 (setNodeId 関数)
 
 指定されたランダムウォーカーのノードIDを設定します。
+ノードIDの取得 (getNodeId 関数)
+
+指定されたランダムウォーカーの起点のノードIDを返します。
+ホップ数の記録 (setHopNum, getHopStatistics 関数)
+
+終了したランダムウォーカーが他サーバに送られた回数を記録し, 終了したもの全体での合計と最大値を返します。
 終了数の取得 (getEndcnt 関数)
 
 終了したランダムウォーカーの数を返します。
+総数の取得 (getRWerNum 関数)
+
+init で指定したランダムウォーカーの総数を返します。
+全終了待ち (waitAllEnd, abortWait 関数)
+
+init で指定した数の RWer が全て終了する (setEndTime が呼ばれる) まで待ちます。
+RWer は必ず起点サーバで終了が記録されるので, 起点サーバごとに「生成数 = 終了数」を確認すれば全体の終了が分かります。
+StartManager から終了の合図が来たら abortWait で待つのをやめ, waitAllEnd は false を返します。
+キャッシュ生成用 RW の終了検出 (startCacheCount, addCacheEndCount, waitCacheEnd 関数)
+
+キャッシュ生成用 RW は個別の記録をしないので, 終了数だけを数え, 生成数に達するまで待ちます。
 実行時間の取得 (getExecutionTime 関数)
 
 最も早く開始されたランダムウォーカーの開始時間から、最も遅く終了したランダムウォーカーの終了時間までの実行時間を計算して返します。
@@ -70,9 +87,36 @@ public:
     // node_id を入力
     void setNodeId(const walker_id_t &RWer_id, const vertex_id_t &node_id);
 
+    // node_id (起点) を入手
+    vertex_id_t getNodeId(const walker_id_t &RWer_id);
+
+    // RWer が他サーバに送られた回数を入力
+    void setHopNum(const walker_id_t &RWer_id, const uint16_t &hop_num);
+
+    // 終了した RWer のホップ数の合計と最大値を入手
+    void getHopStatistics(uint64_t &hop_sum, uint16_t &hop_max);
+
     // RWer 終了数の入手
     walker_id_t getEndcnt();
 
+    // RWer の総数の入手
+    walker_id_t getRWerNum();
+
+    // init で指定した RWer が全て終了するまで待つ (abortWait で打ち切られたら false)
+    bool waitAllEnd();
+
+    // waitAllEnd の待ちを打ち切る
+    void abortWait();
+
+    // キャッシュ生成用 RW の終了数をリセット
+    void startCacheCount();
+
+    // キャッシュ生成用 RW の終了数を加算
+    void addCacheEndCount();
+
+    // キャッシュ生成用 RW が RWer_num 個終了するまで待つ (TERMINATION_TIMEOUT_SEC で諦めて false)
+    bool waitCacheEnd(const walker_id_t &RWer_num);
+
     // 実行時間 (s) を入手 (一番遅い RWer の終了時間 - 一番早く生成された RWer の生成時間)
     double getExecutionTime();
 
@@ -84,9 +128,19 @@ private:
     std::chrono::system_clock::time_point *end_time_per_RWer_id_ = nullptr;   // RWer_id に対する終了時刻
     uint16_t *RWer_life_per_RWer_id_ = nullptr;                               // RWer_id に対する設定歩数
     vertex_id_t *node_id_per_RWer_id_ = nullptr;                              // RWer_id に対する node_id
+    uint16_t *hop_num_per_RWer_id_ = nullptr;                                 // RWer_id に対する他サーバに送られた回数
 
     walker_id_t start_count_ = 0;
     std::atomic<walker_id_t> end_count_ = 0;
+    std::atomic_bool abort_flag_ = false; // waitAllEnd を打ち切るか (init で戻す)
+
+    // キャッシュ生成用 RW の終了数と生成数 (生成が終わるまでは INF)
+    std::atomic<walker_id_t> cache_end_count_ = 0;
+    std::atomic<walker_id_t> cache_RWer_num_ = INF;
+
+    // 終了待ち用
+    std::mutex mtx_end_;
+    std::condition_variable cv_end_;
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -96,12 +150,15 @@ private:
 inline void RandomWalkerManager::init(const walker_id_t &RWer_all)
 {
     RWer_all_num_ = RWer_all;
-    start_flag_per_RWer_id_ = new bool[RWer_all];
-    end_flag_per_RWer_id_ = new bool[RWer_all];
+    start_flag_per_RWer_id_ = new bool[RWer_all]();
+    end_flag_per_RWer_id_ = new bool[RWer_all]();
     start_time_per_RWer_id_ = new std::chrono::system_clock::time_point[RWer_all];
     end_time_per_RWer_id_ = new std::chrono::system_clock::time_point[RWer_all];
-    RWer_life_per_RWer_id_ = new uint16_t[RWer_all];
-    node_id_per_RWer_id_ = new uint64_t[RWer_all];
+    RWer_life_per_RWer_id_ = new uint16_t[RWer_all]();
+    node_id_per_RWer_id_ = new uint64_t[RWer_all]();
+    hop_num_per_RWer_id_ = new uint16_t[RWer_all]();
+    end_count_ = 0;
+    abort_flag_ = false;
 }
 
 inline void RandomWalkerManager::setStartTime(const walker_id_t &RWer_id)
@@ -124,7 +181,11 @@ inline void RandomWalkerManager::setEndTime(const walker_id_t &RWer_id)
     end_time_per_RWer_id_[RWer_id] = std::chrono::system_clock::now();
 
     // addEndCount();
-    end_count_++;
+    if (++end_count_ == RWer_all_num_)
+    { // 最後の RWer が終了した
+        std::lock_guard<std::mutex> lk(mtx_end_);
+        cv_end_.notify_all();
+    }
 }
 
 inline void RandomWalkerManager::setRWerLife(const walker_id_t &RWer_id, const uint16_t &life)
@@ -137,11 +198,78 @@ inline void RandomWalkerManager::setNodeId(const walker_id_t &RWer_id, const uin
     node_id_per_RWer_id_[RWer_id] = node_id;
 }
 
+inline vertex_id_t RandomWalkerManager::getNodeId(const walker_id_t &RWer_id)
+{
+    return node_id_per_RWer_id_[RWer_id];
+}
+
+inline void RandomWalkerManager::setHopNum(const walker_id_t &RWer_id, const uint16_t &hop_num)
+{
+    hop_num_per_RWer_id_[RWer_id] = hop_num;
+}
+
+inline void RandomWalkerManager::getHopStatistics(uint64_t &hop_sum, uint16_t &hop_max)
+{
+    hop_sum = 0;
+    hop_max = 0;
+    for (walker_id_t id = 0; id < RWer_all_num_; id++)
+    {
+        if (end_flag_per_RWer_id_[id])
+        { // 終了しているもののみ
+            hop_sum += hop_num_per_RWer_id_[id];
+            hop_max = std::max(hop_max, hop_num_per_RWer_id_[id]);
+        }
+    }
+}
+
 inline walker_id_t RandomWalkerManager::getEndcnt()
 {
     return end_count_;
 }
 
+inline walker_id_t RandomWalkerManager::getRWerNum()
+{
+    return RWer_all_num_;
+}
+
+inline bool RandomWalkerManager::waitAllEnd()
+{
+    std::unique_lock<std::mutex> lk(mtx_end_);
+    cv_end_.wait(lk, [&]
+                 { return end_count_ >= RWer_all_num_ || abort_flag_; });
+    return end_count_ >= RWer_all_num_;
+}
+
+inline void RandomWalkerManager::abortWait()
+{
+    std::lock_guard<std::mutex> lk(mtx_end_);
+    abort_flag_ = true;
+    cv_end_.notify_all();
+}
+
+inline void RandomWalkerManager::startCacheCount()
+{
+    cache_RWer_num_ = INF;
+    cache_end_count_ = 0;
+}
+
+inline void RandomWalkerManager::addCacheEndCount()
+{
+    if (++cache_end_count_ == cache_RWer_num_)
+    { // 最後の RWer が終了した
+        std::lock_guard<std::mutex> lk(mtx_end_);
+        cv_end_.notify_all();
+    }
+}
+
+inline bool RandomWalkerManager::waitCacheEnd(const walker_id_t &RWer_num)
+{
+    cache_RWer_num_ = RWer_num;
+    std::unique_lock<std::mutex> lk(mtx_end_);
+    return cv_end_.wait_for(lk, std::chrono::seconds(TERMINATION_TIMEOUT_SEC), [&]
+                            { return cache_end_count_ >= cache_RWer_num_; });
+}
+
 inline double RandomWalkerManager::getExecutionTime()
 {
     std::chrono::system_clock::time_point min_start_time = start_time_per_RWer_id_[0];
@@ -0,0 +1,172 @@
+/*
+RandomWalker 用の固定サイズブロックのプール
+RWer は生成スレッド・受信スレッドで作られ, 送信スレッド・処理スレッドで破棄されるので,
+スレッドごとの空きリスト (ロックなし) と, スレッド間で空きブロックをまとめて受け渡す共有デポ (ロックあり) の 2 段構成にする
+デポへのアクセスは WALKER_POOL_BATCH 個単位なので, グローバルアロケータを毎回呼ぶより競合がずっと少ない
+スラブ (WALKER_POOL_BATCH 個分のブロック) は一度確保したらプロセス終了まで解放しない
+
+allocate メソッド:
+スレッドの空きリストから 1 ブロック取り出します。空ならデポから 1 束もらい, デポも空なら新しいスラブを確保します。
+
+deallocate メソッド:
+ブロックをスレッドの空きリストに戻します。空きリストが 2 束分を超えたら 1 束をデポに返します。
+*/
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <new>
+#include <cstddef>
+
+#include "../config/param.hpp"
+
+// 空きブロック (空いている間は先頭に次の空きブロックへのポインタを入れる)
+struct PoolBlock
+{
+    PoolBlock *next;
+};
+
+template <size_t BLOCK_SIZE>
+class FixedBlockPool
+{
+
+public:
+    // 1 ブロック確保
+    static void *allocate();
+
+    // 1 ブロック解放
+    static void deallocate(void *ptr);
+
+private:
+    // 空きブロックの束 (単方向リスト)
+    struct Chain
+    {
+        PoolBlock *head = nullptr;
+        uint32_t num = 0;
+    };
+
+    // スレッドごとの空きリスト (スレッド終了時に残りをデポに返す)
+    struct LocalCache
+    {
+        Chain free_list;
+        ~LocalCache();
+    };
+
+    // スレッド間で共有する空きブロックの束
+    struct Depot
+    {
+        std::mutex mtx;
+        std::vector<Chain> chains;
+    };
+
+    static LocalCache &getLocalCache();
+    static Depot &getDepot();
+
+    // デポ (なければ新しいスラブ) から 1 束もらう
+    static void refill(Chain &free_list);
+
+    // free_list の先頭から num 個を切り出してデポに返す
+    static void flush(Chain &free_list, const uint32_t &num);
+
+    static constexpr size_t STRIDE = (BLOCK_SIZE + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+};
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+template <size_t BLOCK_SIZE>
+inline void *FixedBlockPool<BLOCK_SIZE>::allocate()
+{
+    Chain &free_list = getLocalCache().free_list;
+    if (free_list.head == nullptr)
+        refill(free_list);
+
+    PoolBlock *block = free_list.head;
+    free_list.head = block->next;
+    free_list.num--;
+    return block;
+}
+
+template <size_t BLOCK_SIZE>
+inline void FixedBlockPool<BLOCK_SIZE>::deallocate(void *ptr)
+{
+    if (ptr == nullptr)
+        return;
+
+    Chain &free_list = getLocalCache().free_list;
+    PoolBlock *block = (PoolBlock *)ptr;
+    block->next = free_list.head;
+    free_list.head = block;
+    free_list.num++;
+
+    // 送信スレッドのように解放ばかりするスレッドに溜め込まないよう, 1 束をデポに返す
+    if (free_list.num >= 2 * WALKER_POOL_BATCH)
+        flush(free_list, WALKER_POOL_BATCH);
+}
+
+template <size_t BLOCK_SIZE>
+inline FixedBlockPool<BLOCK_SIZE>::LocalCache::~LocalCache()
+{
+    if (free_list.num > 0)
+        flush(free_list, free_list.num);
+}
+
+template <size_t BLOCK_SIZE>
+inline typename FixedBlockPool<BLOCK_SIZE>::LocalCache &FixedBlockPool<BLOCK_SIZE>::getLocalCache()
+{
+    thread_local LocalCache cache;
+    return cache;
+}
+
+template <size_t BLOCK_SIZE>
+inline typename FixedBlockPool<BLOCK_SIZE>::Depot &FixedBlockPool<BLOCK_SIZE>::getDepot()
+{
+    static Depot depot;
+    return depot;
+}
+
+template <size_t BLOCK_SIZE>
+inline void FixedBlockPool<BLOCK_SIZE>::refill(Chain &free_list)
+{
+    Depot &depot = getDepot();
+    {
+        std::lock_guard<std::mutex> lock(depot.mtx);
+        if (!depot.chains.empty())
+        {
+            free_list = depot.chains.back();
+            depot.chains.pop_back();
+            return;
+        }
+    }
+
+    // デポも空なので新しいスラブを確保して束にする
+    char *slab = (char *)::operator new(STRIDE * WALKER_POOL_BATCH);
+    for (uint32_t i = 0; i < WALKER_POOL_BATCH; i++)
+    {
+        PoolBlock *block = (PoolBlock *)(slab + STRIDE * i);
+        block->next = (i + 1 < WALKER_POOL_BATCH) ? (PoolBlock *)(slab + STRIDE * (i + 1)) : nullptr;
+    }
+    free_list.head = (PoolBlock *)slab;
+    free_list.num = WALKER_POOL_BATCH;
+}
+
+template <size_t BLOCK_SIZE>
+inline void FixedBlockPool<BLOCK_SIZE>::flush(Chain &free_list, const uint32_t &num)
+{
+    Chain chain;
+    chain.head = free_list.head;
+    chain.num = num;
+
+    PoolBlock *tail = free_list.head;
+    for (uint32_t i = 1; i < num; i++)
+        tail = tail->next;
+    free_list.head = tail->next;
+    free_list.num -= num;
+    tail->next = nullptr;
+
+    Depot &depot = getDepot();
+    std::lock_guard<std::mutex> lock(depot.mtx);
+    depot.chains.push_back(chain);
+}
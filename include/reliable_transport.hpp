@@ -0,0 +1,350 @@
+/*
+UDP の RWer メッセージ (RWERS) を取りこぼさないための再送制御
+送信先ごとにシーケンス番号を振り, ACK が返ってくるまでメッセージを再送バッファに残しておく
+受信側は送信元ごとに受信済みのシーケンス番号を記録して重複を捨て, 累積 ACK (次に欲しい番号) と
+その先 64 個分の選択 ACK (ビットマップ) を返す
+プロセスごとに起動時刻からエポックを決めてメッセージと ACK に載せ, 相手が再起動した (エポックが変わった) らその相手のウィンドウをやり直す
+受信側は新しいエポックのメッセージを受け取ると, ヘッダの送信側ウィンドウの先頭から受け付け直す
+ACK 待ちのメッセージ数は RELIABLE_WINDOW_SIZE までで, 埋まっている送信先には ACK が返るまで送らない (待たずに他の送信先を先に送る)
+
+RWERS メッセージのヘッダ:
+ver_id (1B), RWer の個数 (2B), 送信元 HostID (2B), 送信元のエポック (8B), シーケンス番号 (4B), 送信側ウィンドウの先頭 (4B)
+
+ACK メッセージ:
+ver_id (1B), 送信元 (ACK を返す側) HostID (2B), 送信元のエポック (8B), 確認したメッセージの送信元のエポック (8B), 累積 ACK (4B), 選択 ACK (8B)
+
+init メソッド:
+ホスト数分の送信ウィンドウ・受信ウィンドウを用意し, 自プロセスのエポックを決めます。
+
+getEpoch メソッド:
+自プロセスのエポックを返します。
+
+hasSendSpace メソッド:
+送信先のウィンドウに空きがあるかを返します。
+
+registerSend メソッド:
+送信するメッセージにエポック, シーケンス番号, ウィンドウの先頭を書き込み, 再送バッファに保存します。ウィンドウが埋まっていたら保存せずに false を返します (待たない)。
+
+receiveAck メソッド:
+ACK を受け取り, 確認済みのメッセージを再送バッファから外します。
+自プロセスより前のプロセス宛ての ACK と, 送信先の前のプロセスからの ACK は捨てます。
+送信先が再起動していたら, ACK 待ちのメッセージをすぐに再送させます。
+
+resendTimeout メソッド:
+RETRANSMIT_TIMEOUT_MS 以上 ACK が返ってこないメッセージを (ウィンドウの先頭を書き直して) send_func で再送し, 再送した数を返します。
+
+acceptRecv メソッド:
+受信したメッセージのシーケンス番号を記録します。初めて受け取ったものなら true, 重複なら false を返します。
+送信元のエポックが新しくなっていたら受信ウィンドウをやり直し, 古いエポックのメッセージは捨てます。
+
+getAck メソッド:
+送信元に返す累積 ACK と選択 ACK, 確認した送信元のエポックを入手します。
+
+getInFlightNum メソッド:
+ACK 待ちのメッセージ数 (全送信先の合計) を返します。
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <cstring>
+
+#include "type.hpp"
+#include "../config/param.hpp"
+
+// RWERS メッセージのヘッダ内の位置
+const uint32_t RWERS_COUNT_POS = 1;
+const uint32_t RWERS_SRC_POS = 3;
+const uint32_t RWERS_EPOCH_POS = 5;
+const uint32_t RWERS_SEQ_POS = 13;
+const uint32_t RWERS_BASE_POS = 17;
+const uint32_t RWERS_HEADER_SIZE = 21;
+
+// ACK メッセージの長さ
+const uint32_t ACK_MESSAGE_LENGTH = 31;
+
+class ReliableTransport
+{
+
+public:
+    // ホスト数分のウィンドウを用意
+    void init(const uint32_t &host_num);
+
+    // 自プロセスのエポックを入手
+    uint64_t getEpoch();
+
+    // 送信先のウィンドウに空きがあるか
+    bool hasSendSpace(const host_id_t &dst);
+
+    // 送信するメッセージにエポックとシーケンス番号を書き込み, 再送バッファに保存 (ウィンドウが埋まっていたら false)
+    bool registerSend(const host_id_t &dst, char *message, const uint32_t &length);
+
+    // ACK を反映
+    void receiveAck(const host_id_t &dst, const uint64_t &ack_epoch, const uint64_t &acked_epoch, const uint32_t &cum_ack, const uint64_t &sack);
+
+    // タイムアウトしたメッセージを再送 (send_func(const char*, uint32_t) で送信)
+    template <typename F>
+    uint32_t resendTimeout(const host_id_t &dst, F &&send_func);
+
+    // 受信したシーケンス番号を記録 (初めてなら true)
+    bool acceptRecv(const host_id_t &src, const uint64_t &epoch, const uint32_t &seq, const uint32_t &base);
+
+    // 送信元に返す ACK を入手
+    void getAck(const host_id_t &src, uint64_t &acked_epoch, uint32_t &cum_ack, uint64_t &sack);
+
+    // ACK 待ちのメッセージ数を入手
+    uint32_t getInFlightNum();
+
+private:
+    // 再送バッファの 1 メッセージ分
+    struct SendSlot
+    {
+        std::vector<char> data;
+        uint32_t length = 0;
+        bool acked = true;
+        std::chrono::steady_clock::time_point sent_time;
+    };
+
+    // 送信先ごとの状態
+    struct SendWindow
+    {
+        std::mutex mtx;
+        uint32_t base = 0;       // 最も古い ACK 待ちのシーケンス番号
+        uint32_t next_seq = 0;   // 次に振るシーケンス番号
+        uint64_t peer_epoch = 0; // 送信先のエポック (まだ ACK が来ていなければ 0)
+        std::vector<SendSlot> slots;
+    };
+
+    // 送信元ごとの状態
+    struct RecvWindow
+    {
+        std::mutex mtx;
+        uint64_t epoch = 0;             // 送信元のエポック (まだ受け取っていなければ 0)
+        uint32_t expected = 0;          // 次に欲しいシーケンス番号 (これより前は全て受信済み)
+        std::vector<uint64_t> received; // expected 以降の受信済みビットマップ (seq % RELIABLE_WINDOW_SIZE)
+    };
+
+    bool isReceived(RecvWindow &window, const uint32_t &seq);
+
+    // base より前を受信済みとして受信ウィンドウを進める
+    void skipRecv(RecvWindow &window, const uint32_t &base);
+
+    std::unique_ptr<SendWindow[]> send_windows_;
+    std::unique_ptr<RecvWindow[]> recv_windows_;
+    uint32_t host_num_ = 0;
+    uint64_t epoch_ = 0; // 自プロセスのエポック (起動時刻 ns, 再起動すると大きくなる)
+};
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+inline void ReliableTransport::init(const uint32_t &host_num)
+{
+    host_num_ = host_num;
+    epoch_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    send_windows_.reset(new SendWindow[host_num]);
+    recv_windows_.reset(new RecvWindow[host_num]);
+    for (uint32_t i = 0; i < host_num; i++)
+    {
+        send_windows_[i].slots.resize(RELIABLE_WINDOW_SIZE);
+        recv_windows_[i].received.assign(RELIABLE_WINDOW_SIZE / 64, 0);
+    }
+}
+
+inline uint64_t ReliableTransport::getEpoch()
+{
+    return epoch_;
+}
+
+inline bool ReliableTransport::hasSendSpace(const host_id_t &dst)
+{
+    SendWindow &window = send_windows_[dst];
+    std::lock_guard<std::mutex> lk(window.mtx);
+    return window.next_seq - window.base < RELIABLE_WINDOW_SIZE;
+}
+
+inline bool ReliableTransport::registerSend(const host_id_t &dst, char *message, const uint32_t &length)
+{
+    SendWindow &window = send_windows_[dst];
+    std::lock_guard<std::mutex> lk(window.mtx);
+
+    // ウィンドウが埋まっていたら待たずに断る
+    if (window.next_seq - window.base >= RELIABLE_WINDOW_SIZE)
+        return false;
+
+    uint32_t seq = window.next_seq++;
+    memcpy(message + RWERS_EPOCH_POS, &epoch_, sizeof(epoch_));
+    memcpy(message + RWERS_SEQ_POS, &seq, sizeof(seq));
+    memcpy(message + RWERS_BASE_POS, &window.base, sizeof(window.base));
+
+    SendSlot &slot = window.slots[seq % RELIABLE_WINDOW_SIZE];
+    if (slot.data.size() < length)
+        slot.data.resize(MESSAGE_MAX_LENGTH_SEND);
+    memcpy(slot.data.data(), message, length);
+    slot.length = length;
+    slot.acked = false;
+    slot.sent_time = std::chrono::steady_clock::now();
+
+    return true;
+}
+
+inline void ReliableTransport::receiveAck(const host_id_t &dst, const uint64_t &ack_epoch, const uint64_t &acked_epoch, const uint32_t &cum_ack, const uint64_t &sack)
+{
+    // 自プロセスより前のプロセスが送ったメッセージへの ACK は捨てる
+    if (dst >= host_num_ || acked_epoch != epoch_)
+        return;
+
+    SendWindow &window = send_windows_[dst];
+    std::lock_guard<std::mutex> lk(window.mtx);
+
+    // 送信先の前のプロセスからの ACK は捨てる
+    if (ack_epoch < window.peer_epoch)
+        return;
+
+    uint32_t in_flight = window.next_seq - window.base;
+
+    // 送信先が再起動していたら, ACK 待ちのメッセージは届いていないのですぐに再送させる
+    if (window.peer_epoch != 0 && ack_epoch > window.peer_epoch)
+    {
+        for (uint32_t i = 0; i < in_flight; i++)
+            window.slots[(window.base + i) % RELIABLE_WINDOW_SIZE].sent_time = std::chrono::steady_clock::time_point();
+    }
+    window.peer_epoch = ack_epoch;
+
+    // 累積 ACK: cum_ack より前は全て受信済み
+    uint32_t cum_num = cum_ack - window.base;
+    if (cum_num <= in_flight)
+    {
+        for (uint32_t i = 0; i < cum_num; i++)
+            window.slots[(window.base + i) % RELIABLE_WINDOW_SIZE].acked = true;
+    }
+
+    // 選択 ACK: cum_ack + 1 + i が受信済み
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        if (((sack >> i) & 1) == 0)
+            continue;
+        uint32_t seq = cum_ack + 1 + i;
+        if (seq - window.base < in_flight)
+            window.slots[seq % RELIABLE_WINDOW_SIZE].acked = true;
+    }
+
+    // 先頭から確認済みの分だけウィンドウを進める
+    while (window.base != window.next_seq && window.slots[window.base % RELIABLE_WINDOW_SIZE].acked)
+        window.base++;
+}
+
+template <typename F>
+inline uint32_t ReliableTransport::resendTimeout(const host_id_t &dst, F &&send_func)
+{
+    SendWindow &window = send_windows_[dst];
+    std::lock_guard<std::mutex> lk(window.mtx);
+
+    auto now = std::chrono::steady_clock::now();
+    uint32_t resend_num = 0;
+    for (uint32_t seq = window.base; seq != window.next_seq; seq++)
+    {
+        SendSlot &slot = window.slots[seq % RELIABLE_WINDOW_SIZE];
+        if (slot.acked || now - slot.sent_time < std::chrono::milliseconds(RETRANSMIT_TIMEOUT_MS))
+            continue;
+
+        // 受信側が受け付け直すときの先頭は今のウィンドウの先頭にする
+        memcpy(slot.data.data() + RWERS_BASE_POS, &window.base, sizeof(window.base));
+        send_func(slot.data.data(), slot.length);
+        slot.sent_time = now;
+        resend_num++;
+    }
+    return resend_num;
+}
+
+inline bool ReliableTransport::isReceived(RecvWindow &window, const uint32_t &seq)
+{
+    uint32_t bit = seq % RELIABLE_WINDOW_SIZE;
+    return (window.received[bit / 64] >> (bit % 64)) & 1;
+}
+
+inline void ReliableTransport::skipRecv(RecvWindow &window, const uint32_t &base)
+{
+    uint32_t skip_num = base - window.expected;
+    if (skip_num >= RELIABLE_WINDOW_SIZE)
+        std::fill(window.received.begin(), window.received.end(), 0);
+    else
+    {
+        for (uint32_t i = 0; i < skip_num; i++)
+        {
+            uint32_t bit = (window.expected + i) % RELIABLE_WINDOW_SIZE;
+            window.received[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+        }
+    }
+    window.expected = base;
+}
+
+inline bool ReliableTransport::acceptRecv(const host_id_t &src, const uint64_t &epoch, const uint32_t &seq, const uint32_t &base)
+{
+    if (src >= host_num_)
+        return false;
+
+    RecvWindow &window = recv_windows_[src];
+    std::lock_guard<std::mutex> lk(window.mtx);
+
+    if (epoch < window.epoch)
+        return false; // 送信元の前のプロセスのメッセージ
+
+    if (epoch > window.epoch)
+    { // 送信元が再起動した (または初めて受け取った) ので, 送信側ウィンドウの先頭から受け付け直す
+        window.epoch = epoch;
+        std::fill(window.received.begin(), window.received.end(), 0);
+        window.expected = base;
+    }
+    else if ((int32_t)(base - window.expected) > 0)
+    { // 送信側で確認済みになった分は受信済みとして進める
+        skipRecv(window, base);
+    }
+
+    // 受信済み (expected より前) かウィンドウ外なら捨てる
+    if (seq - window.expected >= RELIABLE_WINDOW_SIZE || isReceived(window, seq))
+        return false;
+
+    uint32_t bit = seq % RELIABLE_WINDOW_SIZE;
+    window.received[bit / 64] |= (uint64_t)1 << (bit % 64);
+
+    // 連続して受信済みになった分だけ expected を進める
+    while (isReceived(window, window.expected))
+    {
+        uint32_t expected_bit = window.expected % RELIABLE_WINDOW_SIZE;
+        window.received[expected_bit / 64] &= ~((uint64_t)1 << (expected_bit % 64));
+        window.expected++;
+    }
+    return true;
+}
+
+inline void ReliableTransport::getAck(const host_id_t &src, uint64_t &acked_epoch, uint32_t &cum_ack, uint64_t &sack)
+{
+    RecvWindow &window = recv_windows_[src];
+    std::lock_guard<std::mutex> lk(window.mtx);
+
+    acked_epoch = window.epoch;
+    cum_ack = window.expected;
+    sack = 0;
+    for (uint32_t i = 0; i < 64 && i + 1 < RELIABLE_WINDOW_SIZE; i++)
+    {
+        if (isReceived(window, cum_ack + 1 + i))
+            sack |= (uint64_t)1 << i;
+    }
+}
+
+inline uint32_t ReliableTransport::getInFlightNum()
+{
+    uint32_t in_flight = 0;
+    for (uint32_t i = 0; i < host_num_; i++)
+    {
+        std::lock_guard<std::mutex> lk(send_windows_[i].mtx);
+        in_flight += send_windows_[i].next_seq - send_windows_[i].base;
+    }
+    return in_flight;
+}
@@ -7,6 +7,7 @@ hostname_：ホスト名を保持します。
 hostip_：IPアドレス（数値形式）を保持します。
 hostip_str_：IPアドレス（文字列形式）を保持します。
 RW_execution_num_：ランダムウォークの実行回数を保持します。
+run_id_：実験の ID を保持します (sendStart のたびに進め, 開始・終了の合図と結果に付けて前の実験の結果と区別します)。
 worker_ip_：実験に使用するワーカーのIPアドレスを保持します。　　？？？
 split_num_：グラフのスプリット数（分割数）を保持します。
 MESSAGE_LENGTH：メッセージの長さ（バイト単位）を定義します。
@@ -19,13 +20,20 @@ TCPソケットを作成し、各ワーカーからの終了報告を受け取
 全てのワーカーに終了報告を送信するために、TCPソケットを作成してメッセージを送信します。
 
 sendStart
-UDPソケットを作成し、各ワーカーに対して実験開始の指示メッセージを送信します。
+UDPソケットを作成し、各ワーカーに対して実験開始の指示メッセージ (実験の ID 付き) を送信します。
 
 sendEnd
 UDPソケットを作成し、各ワーカーに対して実験終了の指示メッセージを送信します。
 TCPソケットを作成し、各ワーカーからの終了報告を受け取ります。
 実験結果を ofs_time および ofs_rerun に出力します。
 
+receiveResults
+各ワーカーは自分が生成した RWer が全て終了した時点で結果を送ってくるので, 全ワーカーの結果が揃うまで待ちます (終了検出)。
+TERMINATION_TIMEOUT_SEC 待っても揃わない場合は, まだ結果を送ってきていないワーカーに実験終了の指示を送って結果を集めます。
+その後さらに TERMINATION_TIMEOUT_SEC 待っても揃わなければ, 揃った分だけで集計します。
+実験の ID が違う結果 (前の実験で遅れて届いたもの) は捨てます。
+実験結果を ofs_time および ofs_rerun に出力します。
+
 
 ホスト名とIPアドレスの管理: コンストラクタで自サーバーのホスト名とIPアドレスを取得し、設定します。
 メッセージの送信: sendStartCache、sendStart、sendEnd メソッドを使用して、ワーカーに対してキャッシュ生成、実験開始、実験終了の指示を送信します。
@@ -51,6 +59,8 @@ TCPソケットを作成し、各ワーカーからの終了報告を受け取
 #include <sstream>
 #include <fstream>
 #include <unordered_map>
+#include <algorithm>
+#include <poll.h>
 
 #include "../config/param.hpp"
 
@@ -74,6 +84,12 @@ public:
     // 実験終了の合図
     void sendEnd(std::ofstream &ofs_time, std::ofstream &ofs_rerun);
 
+    // 実験結果の受信 (全ワーカーの RWer が終了するまで待つ)
+    void receiveResults(std::ofstream &ofs_time, std::ofstream &ofs_rerun);
+
+    // 実験終了の指示メッセージを送信 (reported[i] が true のワーカーには送らない)
+    void sendEndSignal(const std::vector<bool> &reported);
+
     // IPv4 サーバソケットを作成 (UDP)
     int createUdpServerSocket();
 
@@ -85,6 +101,7 @@ private:
     uint32_t hostip_;        // StartManager の IP アドレス
     std::string hostip_str_; // IP アドレスの文字列
     uint32_t RW_execution_num_ = 0;
+    uint32_t run_id_ = 0; // 実験の ID (StartManager を起動し直しても重ならないように起動時刻から始める)
     std::vector<uint32_t> worker_ip_; // 実験で使う通信先 IP アドレス
     uint32_t split_num_ = 0;
 
@@ -149,6 +166,7 @@ inline StartManager::StartManager(const uint32_t &split_num)
     }
 
     split_num_ = split_num;
+    run_id_ = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
 inline void StartManager::sendStartCache()
@@ -286,8 +304,9 @@ inline void StartManager::sendStart(std::ofstream &ofs_time, std::ofstream &ofs_
     }
 
     RW_execution_num_ = RW_num;
+    run_id_++;
 
-    std::cout << "start" << std::endl;
+    std::cout << "start: run_id = " << run_id_ << std::endl;
 
     for (int i = 0; i < split_num_; i++)
     {
@@ -298,7 +317,7 @@ inline void StartManager::sendStart(std::ofstream &ofs_time, std::ofstream &ofs_
         addr.sin_port = htons(10000);                 // ポート番号, htons()関数は16bitホストバイトオーダーをネットワークバイトオーダーに変換
         addr.sin_addr.s_addr = worker_ip_[i];         // IPアドレス, inet_addr()関数はアドレスの翻訳
 
-        // メッセージ生成 (id: 1B, IPアドレス: 4B, RW 実行回数: 4B)
+        // メッセージ生成 (id: 1B, IPアドレス: 4B, RW 実行回数: 4B, 実験の ID: 4B)
         char message[MESSAGE_LENGTH];
 
         // メッセージのヘッダ情報を書き込む
@@ -308,6 +327,7 @@ inline void StartManager::sendStart(std::ofstream &ofs_time, std::ofstream &ofs_
         memcpy(message, &ver_id, sizeof(uint8_t));
         memcpy(message + sizeof(ver_id), &hostip_, sizeof(hostip_));
         memcpy(message + sizeof(ver_id) + sizeof(hostip_), &RW_execution_num_, sizeof(RW_execution_num_));
+        memcpy(message + sizeof(ver_id) + sizeof(hostip_) + sizeof(RW_execution_num_), &run_id_, sizeof(run_id_));
 
         // データ送信
         sendto(sockfd, message, MESSAGE_LENGTH, 0, (struct sockaddr *)&addr, sizeof(addr)); // 送信
@@ -323,8 +343,19 @@ inline void StartManager::sendStart(std::ofstream &ofs_time, std::ofstream &ofs_
 inline void StartManager::sendEnd(std::ofstream &ofs_time, std::ofstream &ofs_rerun)
 {
     // split_num 個のサーバに合図を送信
+    sendEndSignal(std::vector<bool>(split_num_, false));
+
+    // split_num 個のサーバから実験結果を受け取る
+    receiveResults(ofs_time, ofs_rerun);
+}
+
+inline void StartManager::sendEndSignal(const std::vector<bool> &reported)
+{
     for (int i = 0; i < split_num_; i++)
     {
+        if (reported[i])
+            continue;
+
         // ソケットの生成
         int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
         if (sockfd < 0)
@@ -340,14 +371,15 @@ inline void StartManager::sendEnd(std::ofstream &ofs_time, std::ofstream &ofs_re
         addr.sin_port = htons(10000);                 // ポート番号, htons()関数は16bitホストバイトオーダーをネットワークバイトオーダーに変換
         addr.sin_addr.s_addr = worker_ip_[i];         // IPアドレス, inet_addr()関数はアドレスの翻訳
 
-        // メッセージ生成 (id: 1B)
+        // メッセージ生成 (id: 1B, 実験の ID: 4B)
         char message[MESSAGE_LENGTH];
 
         // メッセージのヘッダ情報を書き込む
         // バージョン: 4bit (0),
-        // メッセージID: 4bit (4),
+        // メッセージID: 4bit (5),
         uint8_t ver_id = END_EXP;
         memcpy(message, &ver_id, sizeof(uint8_t));
+        memcpy(message + sizeof(ver_id), &run_id_, sizeof(run_id_));
 
         // データ送信
         sendto(sockfd, message, MESSAGE_LENGTH, 0, (struct sockaddr *)&addr, sizeof(addr)); // 送信
@@ -358,16 +390,39 @@ inline void StartManager::sendEnd(std::ofstream &ofs_time, std::ofstream &ofs_re
         // debug
         std::cout << i << std::endl;
     }
+}
 
+inline void StartManager::receiveResults(std::ofstream &ofs_time, std::ofstream &ofs_rerun)
+{
     // split_num 個のサーバから実験結果を受け取る
-    int count = 0;                        // 終了の合図が来た回数
-    int sum_end_count = 0;                // end_count の総和
-    double max_all_execution_time = 0;    // 最後の RWer が終了するときまでの時間
-    int sockfd = createTcpServerSocket(); // サーバソケットを生成 (TCP)
+    int count = 0;                               // 終了の合図が来た回数
+    int sum_end_count = 0;                       // end_count の総和
+    double max_all_execution_time = 0;           // 最後の RWer が終了するときまでの時間
+    uint32_t sum_re_send_count = 0;              // 再送したメッセージ数の総和
+    uint32_t sum_in_flight_count = 0;            // 終了時点で ACK が返っていないメッセージ数の総和
+    uint64_t sum_hop = 0;                        // RWer が他サーバに送られた回数の総和
+    uint16_t max_hop = 0;                        // 1 つの RWer が他サーバに送られた回数の最大値
+    std::vector<bool> reported(split_num_, false); // 結果を送ってきたワーカー
+    bool end_signal_sent = false;                // タイムアウトして終了の合図を送ったか
+    int sockfd = createTcpServerSocket();        // サーバソケットを生成 (TCP)
 
     while (count < split_num_)
     {
-        // 接続待ち
+        // 接続待ち (タイムアウトしたら, まだのワーカーに終了の合図を送って結果を出させる)
+        struct pollfd pfd = {sockfd, POLLIN, 0};
+        if (poll(&pfd, 1, TERMINATION_TIMEOUT_SEC * 1000) == 0)
+        {
+            if (end_signal_sent)
+            { // 終了の合図にも応答がない (開始の合図が届かなかったなど) ので, 揃った分だけで集計する
+                std::cout << "termination timeout, " << split_num_ - count << " workers did not report" << std::endl;
+                break;
+            }
+            std::cout << "termination timeout, send end" << std::endl;
+            sendEndSignal(reported);
+            end_signal_sent = true;
+            continue;
+        }
+
         struct sockaddr_in get_addr;                                      // 接続相手のソケットアドレス
         socklen_t len = sizeof(struct sockaddr_in);                       // 接続相手のアドレスサイズ
         int connect = accept(sockfd, (struct sockaddr *)&get_addr, &len); // 接続待ちソケット, 接続相手のソケットアドレスポインタ, 接続相手のアドレスサイズ
@@ -377,33 +432,58 @@ inline void StartManager::sendEnd(std::ofstream &ofs_time, std::ofstream &ofs_re
             exit(1); // 異常終了
         }
 
-        char message[1024];                         // 受信バッファ
-        memset(message, 0, sizeof(message));        // 受信バッファ初期化
-        recv(connect, message, sizeof(message), 0); // 受信 (hostip: 4B, end_count: 4B, all_execution_time: 8B)
+        char message[1024];                                   // 受信バッファ
+        memset(message, 0, sizeof(message));                  // 受信バッファ初期化
+        recv(connect, message, sizeof(message), MSG_WAITALL); // 受信 (hostip: 4B, end_count: 4B, all_execution_time: 8B, re_send_count: 4B, in_flight_count: 4B, hop_sum: 8B, hop_max: 2B, run_id: 4B)
+
+        close(connect); // acceptしたソケットをclose
 
         uint32_t *worker_ip = (uint32_t *)message;
         uint32_t *end_count = (uint32_t *)(message + sizeof(uint32_t));
         double *execution_time = (double *)(message + sizeof(uint32_t) + sizeof(uint32_t));
+        uint32_t *re_send_count = (uint32_t *)(message + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(double));
+        uint32_t *in_flight_count = (uint32_t *)(message + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(double) + sizeof(uint32_t));
+        uint64_t hop_sum;
+        uint16_t hop_max;
+        memcpy(&hop_sum, message + sizeof(uint32_t) * 4 + sizeof(double), sizeof(uint64_t));
+        memcpy(&hop_max, message + sizeof(uint32_t) * 4 + sizeof(double) + sizeof(uint64_t), sizeof(uint16_t));
+        uint32_t run_id;
+        memcpy(&run_id, message + sizeof(uint32_t) * 4 + sizeof(double) + sizeof(uint64_t) + sizeof(uint16_t), sizeof(uint32_t));
+
+        // 前の実験の結果 (打ち切った後に遅れて届いたもの) は無視
+        if (run_id != run_id_)
+        {
+            std::cout << "result of another run: " << run_id << " (now " << run_id_ << ")" << std::endl;
+            continue;
+        }
+
+        // 同じワーカーからの 2 回目以降の結果 (終了の合図への応答と重なったもの) は無視
+        auto it = std::find(worker_ip_.begin(), worker_ip_.begin() + split_num_, *worker_ip);
+        if (it == worker_ip_.begin() + split_num_ || reported[it - worker_ip_.begin()])
+            continue;
+        reported[it - worker_ip_.begin()] = true;
 
         sum_end_count += *end_count;
+        sum_re_send_count += *re_send_count;
+        sum_in_flight_count += *in_flight_count;
+        sum_hop += hop_sum;
+        max_hop = std::max(max_hop, hop_max);
 
         max_all_execution_time = std::max(max_all_execution_time, *execution_time);
 
-        close(connect); // acceptしたソケットをclose
-
         count++;
     }
+    close(sockfd);
 
     // int drop_UDP = RW_execution_num_*split_num_*subgraph_size_ - sum_end_count;
     // std::cout << "drop_UDP : " << drop_UDP << std::endl;
     std::cout << "sum_end_count : " << sum_end_count << std::endl;
     std::cout << "max_all_execution_time : " << max_all_execution_time << std::endl;
-
+    std::cout << "sum_re_send_count : " << sum_re_send_count << std::endl;
+    std::cout << "sum_in_flight_count : " << sum_in_flight_count << std::endl;
+    std::cout << "average_hop : " << (sum_end_count == 0 ? 0 : (double)sum_hop / sum_end_count) << ", max_hop : " << max_hop << std::endl;
     ofs_time << max_all_execution_time << std::endl;
-    // ofs_rerun << (double)drop_UDP / (split_num_*RW_execution_num_*subgraph_size_) * 100 << std::endl;
-
-    // サーバソケットクローズ
-    close(sockfd);
+    ofs_rerun << sum_re_send_count << " " << sum_in_flight_count << std::endl;
 }
 
 inline int StartManager::createUdpServerSocket()
@@ -4,15 +4,102 @@ const char* fname: 読み込むファイルの名前を示す文字列。
 T* &edge: 読み込んだエッジデータを格納するためのポインタの参照。関数内で動的に割り当てられます。
 edge_id_t &e_num: 読み込んだエッジの数を格納するための参照。
 
+パーティションファイル (CSR 形式, バージョン付き) の入出力
+頂点はローカル ID で管理する. 自サーバが持ち主の頂点が [0, owned_num), 境界の他サーバ頂点 (ghost) が [owned_num, local_num)
+(それぞれグローバル ID の昇順) で, メモリ使用量はパーティションの大きさだけで決まる
+ファイルは先頭から ヘッダ, グローバル ID 配列, オフセット配列, 隣接頂点配列 (ローカル ID, 頂点ごとにグローバル ID の昇順),
+HostID 配列, グローバル ID -> ローカル ID のハッシュ表, (重み付きグラフなら) エッジの重み配列 の順に並ぶ
+重み配列は隣接頂点配列と同じ並びで, 重みなしのグラフではヘッダの weights_pos が 0 になる
+各セクションは 8 byte 境界に配置されるので, mmap した領域をそのまま配列として参照できる
+ヘッダには分割全体 (全パーティションのエッジとその持ち主) のチェックサムも入れる. 他サーバのパーティションが変わったことを各サーバで検出するため
+バージョン 2 のファイル (重みなし, weights_pos の位置は予備で 0), バージョン 3 のファイル (分割全体のチェックサムなし) もそのまま読める
+
+build_partition:
+Edge_dstIp の配列から CSR 形式のパーティションデータを構築します。
+weighted が true ならエッジの重みも隣接頂点と同じ並びで保存します。
+
+write_partition:
+パーティションデータをファイルに書き込みます。
+
+partition_edge_hash / partitioning_checksum:
+分割全体のチェックサムを計算します。分割するツールは全パーティションの全エッジの partition_edge_hash を足し, partitioning_checksum で仕上げて PartitionData に入れます。
+
+map_partition:
+パーティションファイルを mmap し, 各セクションの先頭ポインタを返します。
+ヘッダのマジックナンバーが一致しない場合 (旧形式の Edge_dstIp 配列) は false を返します。
 */
 
 #pragma once
 
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <vector>
+#include <algorithm>
+#include <iostream>
 
 #include "type.hpp"
+#include "vertex_index.hpp"
+#include "../config/param.hpp"
+
+// パーティションファイルの識別子とバージョン
+const uint64_t PARTITION_MAGIC = 0x3150574452574452; // "RDWRDWP1"
+const uint32_t PARTITION_VERSION = 4;
+const uint32_t PARTITION_MIN_VERSION = 2; // 読み込める最も古いバージョン
+
+// パーティションファイルのヘッダ (104 byte, バージョン 3 以前は partitioning_checksum のない 96 byte)
+struct PartitionHeader
+{
+    uint64_t magic;          // PARTITION_MAGIC
+    uint32_t version;        // PARTITION_VERSION
+    host_id_t host_id;       // パーティションの持ち主の HostID
+    uint64_t owned_num;      // 自サーバが持ち主の頂点数
+    uint64_t local_num;      // ローカル ID を持つ頂点数 (自サーバの頂点 + ghost 頂点)
+    uint64_t edge_num;       // エッジ数
+    uint64_t index_slot_num; // ハッシュ表のスロット数
+    uint64_t global_ids_pos; // グローバル ID 配列の位置 (byte)
+    uint64_t offsets_pos;    // オフセット配列の位置 (byte)
+    uint64_t neighbours_pos; // 隣接頂点配列の位置 (byte)
+    uint64_t host_ids_pos;   // HostID 配列の位置 (byte)
+    uint64_t index_pos;      // ハッシュ表の位置 (byte)
+    uint64_t weights_pos;    // エッジの重み配列の位置 (byte), 重みなしなら 0 (バージョン 2 では予備)
+    uint64_t partitioning_checksum; // 分割全体のチェックサム (バージョン 4 から)
+};
+const size_t PARTITION_V3_HEADER_SIZE = 96;
+
+// メモリ上に構築したパーティションデータ
+struct PartitionData
+{
+    host_id_t host_id = 0;
+    local_id_t owned_num = 0;
+    std::vector<vertex_id_t> global_ids;     // local_num 個
+    std::vector<edge_id_t> offsets;          // owned_num + 1 個
+    std::vector<local_id_t> neighbours;      // edge_num 個
+    std::vector<host_id_t> host_ids;         // local_num 個
+    std::vector<VertexIndexSlot> index_slots; // index_slot_num 個
+    std::vector<edge_weight_t> weights;       // 重み付きなら edge_num 個, 重みなしなら空
+    uint64_t partitioning_checksum = 0;       // 分割全体のチェックサム (0 なら不明)
+};
+
+// mmap したパーティションファイル
+struct MappedPartition
+{
+    void *addr = nullptr;
+    size_t length = 0;
+    const PartitionHeader *header = nullptr;
+    const vertex_id_t *global_ids = nullptr;
+    const edge_id_t *offsets = nullptr;
+    const local_id_t *neighbours = nullptr;
+    const host_id_t *host_ids = nullptr;
+    const VertexIndexSlot *index_slots = nullptr;
+    const edge_weight_t *weights = nullptr; // 重みなしなら nullptr
+    uint64_t partitioning_checksum = 0;     // 分割全体のチェックサム (バージョン 3 以前のファイルなら 0)
+};
 
 template <typename T>
 void read_graph(const char *fname, T *&edge, edge_id_t &e_num)
@@ -28,4 +115,213 @@ void read_graph(const char *fname, T *&edge, edge_id_t &e_num)
     auto ret = fread(edge, sizeof(T), e_num, f);
     assert(ret == e_num);
     fclose(f);
-}
\ No newline at end of file
+}
+
+// 分割全体のチェックサムに足し込む, パーティション host_id に置くエッジのハッシュ (和を取るので足す順番によらない)
+inline uint64_t partition_edge_hash(const Edge_dstIp &edge, const host_id_t &host_id)
+{
+    uint32_t weight_bits;
+    memcpy(&weight_bits, &edge.weight, sizeof(uint32_t));
+    uint64_t h = hashVertexId(edge.src);
+    h = hashVertexId(h ^ edge.dst);
+    h = hashVertexId(h ^ (((uint64_t)host_id << 40) | ((uint64_t)edge.dst_ip << 32) | weight_bits));
+    return h;
+}
+
+// エッジのハッシュの和と分割数から分割全体のチェックサムを作る (0 は「不明」に使うので避ける)
+inline uint64_t partitioning_checksum(const uint64_t &edge_hash_sum, const uint64_t &edge_num, const int &split_num, const bool &weighted)
+{
+    uint64_t checksum = hashVertexId(edge_hash_sum ^ hashVertexId(edge_num ^ ((uint64_t)split_num << 48) ^ ((uint64_t)weighted << 63)));
+    return checksum == 0 ? 1 : checksum;
+}
+
+// 8 byte 境界に切り上げ
+inline uint64_t align_partition_pos(const uint64_t &pos)
+{
+    return (pos + 7) & ~(uint64_t)7;
+}
+
+inline void build_partition(const Edge_dstIp *edges, const edge_id_t &e_num, const host_id_t &host_id, PartitionData &partition, const bool &weighted = false)
+{
+    // 自サーバの頂点 (src) と ghost 頂点 (自サーバの頂点でない dst) をそれぞれ昇順に並べる
+    std::vector<vertex_id_t> owned(e_num), ghosts;
+    for (edge_id_t e_i = 0; e_i < e_num; e_i++)
+    {
+        owned[e_i] = edges[e_i].src;
+    }
+    std::sort(owned.begin(), owned.end());
+    owned.erase(std::unique(owned.begin(), owned.end()), owned.end());
+    for (edge_id_t e_i = 0; e_i < e_num; e_i++)
+    {
+        if (!std::binary_search(owned.begin(), owned.end(), edges[e_i].dst))
+            ghosts.push_back(edges[e_i].dst);
+    }
+    std::sort(ghosts.begin(), ghosts.end());
+    ghosts.erase(std::unique(ghosts.begin(), ghosts.end()), ghosts.end());
+
+    partition.host_id = host_id;
+    partition.owned_num = owned.size();
+    partition.global_ids = std::move(owned);
+    partition.global_ids.insert(partition.global_ids.end(), ghosts.begin(), ghosts.end());
+    std::vector<vertex_id_t>().swap(ghosts);
+    local_id_t local_num = partition.global_ids.size();
+    VertexIndex::build(partition.global_ids.data(), local_num, partition.index_slots);
+    VertexIndex index;
+    index.attach(partition.index_slots.data(), partition.index_slots.size());
+
+    partition.offsets.assign(partition.owned_num + 1, 0);
+    partition.neighbours.resize(e_num);
+    partition.host_ids.assign(local_num, INF);
+    if (weighted)
+        partition.weights.resize(e_num);
+
+    // 1 パス目: 頂点ごとの次数を数えてオフセットを決める
+    for (edge_id_t e_i = 0; e_i < e_num; e_i++)
+    {
+        partition.offsets[index.find(edges[e_i].src) + 1]++;
+    }
+    for (local_id_t v = 0; v < partition.owned_num; v++)
+    {
+        partition.offsets[v + 1] += partition.offsets[v];
+    }
+
+    // 2 パス目: エッジデータを入れていく
+    std::vector<edge_id_t> cursor(partition.offsets.begin(), partition.offsets.end() - 1);
+    for (edge_id_t e_i = 0; e_i < e_num; e_i++)
+    {
+        const Edge_dstIp &e = edges[e_i];
+        local_id_t src = index.find(e.src);
+        local_id_t dst = index.find(e.dst);
+        partition.host_ids[src] = host_id;
+        if (dst >= partition.owned_num)
+            partition.host_ids[dst] = e.dst_ip;
+        if (weighted)
+            partition.weights[cursor[src]] = e.weight;
+        partition.neighbours[cursor[src]++] = dst;
+    }
+
+    // 隣接リストを頂点ごとにグローバル ID の昇順でソート (index の対応を全サーバで揃えるため)
+    const vertex_id_t *global_ids = partition.global_ids.data();
+    if (!weighted)
+    {
+        for (local_id_t v = 0; v < partition.owned_num; v++)
+        {
+            std::sort(partition.neighbours.begin() + partition.offsets[v], partition.neighbours.begin() + partition.offsets[v + 1],
+                      [&](const local_id_t &a, const local_id_t &b)
+                      { return global_ids[a] < global_ids[b]; });
+        }
+        return;
+    }
+
+    // 重み付きなら (隣接頂点, 重み) の組で並べ替える
+    std::vector<std::pair<local_id_t, edge_weight_t>> adj;
+    for (local_id_t v = 0; v < partition.owned_num; v++)
+    {
+        edge_id_t begin = partition.offsets[v], end = partition.offsets[v + 1];
+        adj.clear();
+        for (edge_id_t e_i = begin; e_i < end; e_i++)
+            adj.emplace_back(partition.neighbours[e_i], partition.weights[e_i]);
+        std::sort(adj.begin(), adj.end(), [&](const std::pair<local_id_t, edge_weight_t> &a, const std::pair<local_id_t, edge_weight_t> &b)
+                  { return global_ids[a.first] < global_ids[b.first]; });
+        for (edge_id_t e_i = begin; e_i < end; e_i++)
+        {
+            partition.neighbours[e_i] = adj[e_i - begin].first;
+            partition.weights[e_i] = adj[e_i - begin].second;
+        }
+    }
+}
+
+inline void write_partition(const char *fname, const PartitionData &partition)
+{
+    PartitionHeader header = {};
+    header.magic = PARTITION_MAGIC;
+    header.version = PARTITION_VERSION;
+    header.host_id = partition.host_id;
+    header.partitioning_checksum = partition.partitioning_checksum;
+    header.owned_num = partition.owned_num;
+    header.local_num = partition.global_ids.size();
+    header.edge_num = partition.neighbours.size();
+    header.index_slot_num = partition.index_slots.size();
+    header.global_ids_pos = align_partition_pos(sizeof(PartitionHeader));
+    header.offsets_pos = align_partition_pos(header.global_ids_pos + sizeof(vertex_id_t) * header.local_num);
+    header.neighbours_pos = align_partition_pos(header.offsets_pos + sizeof(edge_id_t) * (header.owned_num + 1));
+    header.host_ids_pos = align_partition_pos(header.neighbours_pos + sizeof(local_id_t) * header.edge_num);
+    header.index_pos = align_partition_pos(header.host_ids_pos + sizeof(host_id_t) * header.local_num);
+    if (!partition.weights.empty())
+        header.weights_pos = align_partition_pos(header.index_pos + sizeof(VertexIndexSlot) * header.index_slot_num);
+
+    FILE *f = fopen(fname, "w");
+    assert(f != NULL);
+    auto write_section = [&](const uint64_t &pos, const void *data, const size_t &size, const size_t &num)
+    {
+        fseek(f, pos, SEEK_SET);
+        auto ret = fwrite(data, size, num, f);
+        assert(ret == num);
+    };
+    write_section(0, &header, sizeof(PartitionHeader), 1);
+    write_section(header.global_ids_pos, partition.global_ids.data(), sizeof(vertex_id_t), partition.global_ids.size());
+    write_section(header.offsets_pos, partition.offsets.data(), sizeof(edge_id_t), partition.offsets.size());
+    write_section(header.neighbours_pos, partition.neighbours.data(), sizeof(local_id_t), partition.neighbours.size());
+    write_section(header.host_ids_pos, partition.host_ids.data(), sizeof(host_id_t), partition.host_ids.size());
+    write_section(header.index_pos, partition.index_slots.data(), sizeof(VertexIndexSlot), partition.index_slots.size());
+    if (header.weights_pos != 0)
+        write_section(header.weights_pos, partition.weights.data(), sizeof(edge_weight_t), partition.weights.size());
+    fclose(f);
+}
+
+inline bool map_partition(const char *fname, MappedPartition &mapped)
+{
+    int fd = open(fname, O_RDONLY);
+    assert(fd >= 0);
+    struct stat st;
+    fstat(fd, &st);
+    size_t length = st.st_size;
+
+    // ヘッダを確認 (旧形式なら false). バージョン 3 以前のヘッダは短いので, 先に共通部分だけ読む
+    PartitionHeader header = {};
+    if (length < PARTITION_V3_HEADER_SIZE || pread(fd, &header, PARTITION_V3_HEADER_SIZE, 0) != (ssize_t)PARTITION_V3_HEADER_SIZE || header.magic != PARTITION_MAGIC)
+    {
+        close(fd);
+        return false;
+    }
+    if (header.version < PARTITION_MIN_VERSION || header.version > PARTITION_VERSION)
+    {
+        std::cerr << "map_partition: unsupported version " << header.version << " (" << fname << "), split_graph で作り直してください" << std::endl;
+        exit(1);
+    }
+    if (header.version < 3)
+        header.weights_pos = 0;
+    if (header.version >= 4 && (length < sizeof(PartitionHeader) || pread(fd, &header, sizeof(PartitionHeader), 0) != sizeof(PartitionHeader)))
+    {
+        std::cerr << "map_partition: truncated file " << fname << std::endl;
+        exit(1);
+    }
+    if (header.index_pos + sizeof(VertexIndexSlot) * header.index_slot_num > length ||
+        (header.weights_pos != 0 && header.weights_pos + sizeof(edge_weight_t) * header.edge_num > length))
+    {
+        std::cerr << "map_partition: truncated file " << fname << std::endl;
+        exit(1);
+    }
+
+    void *addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        perror("mmap");
+        exit(1);
+    }
+    madvise(addr, length, MADV_WILLNEED); // 先読みだけ依頼してすぐに返る
+
+    const char *base = (const char *)addr;
+    mapped.addr = addr;
+    mapped.length = length;
+    mapped.header = (const PartitionHeader *)base;
+    mapped.global_ids = (const vertex_id_t *)(base + header.global_ids_pos);
+    mapped.offsets = (const edge_id_t *)(base + header.offsets_pos);
+    mapped.neighbours = (const local_id_t *)(base + header.neighbours_pos);
+    mapped.host_ids = (const host_id_t *)(base + header.host_ids_pos);
+    mapped.index_slots = (const VertexIndexSlot *)(base + header.index_pos);
+    mapped.weights = header.weights_pos != 0 ? (const edge_weight_t *)(base + header.weights_pos) : nullptr;
+    mapped.partitioning_checksum = header.partitioning_checksum;
+    return true;
+}
@@ -11,6 +11,8 @@ typedef uint64_t walker_id_t;
 typedef uint32_t host_id_t;
 typedef uint16_t worker_id_t;
 typedef uint64_t index_t;
+typedef uint32_t local_id_t;
+typedef float edge_weight_t;
 
 struct EmptyData
 {
@@ -55,14 +57,17 @@ struct Edge<EmptyData>
     }
 };
 
+// weight は dst_ip の後ろの詰め物の位置に入るので, 構造体の大きさ (旧形式のファイルの 1 エッジ分) は変わらない
+// 旧形式のファイルの weight は未定義なので使わない
 struct Edge_dstIp
 {
     vertex_id_t src;
     vertex_id_t dst;
     uint8_t dst_ip;
+    edge_weight_t weight;
 
     Edge_dstIp() {}
-    Edge_dstIp(vertex_id_t _src, vertex_id_t _dst, uint8_t _dst_ip) : src(_src), dst(_dst), dst_ip(_dst_ip) {}
+    Edge_dstIp(vertex_id_t _src, vertex_id_t _dst, uint8_t _dst_ip, edge_weight_t _weight = 1) : src(_src), dst(_dst), dst_ip(_dst_ip), weight(_weight) {}
     bool friend operator==(const Edge_dstIp &a, const Edge_dstIp &b)
     {
         return (a.src == b.src && a.dst == b.dst);
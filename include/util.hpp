@@ -1,15 +1,21 @@
 /*
-ランダム数生成と時間計測の機能の提供
+ランダム数生成と時間計測, スレッドのコア固定の機能の提供
 何も考えずにそのまま使用すればよさそう
+乱数生成器は RW の 1 歩ごとに呼ばれるので, 小さな状態の xoshiro256** を使う
 */
 #pragma once
 
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <cstdio>
 
 #include <random>
 #include <chrono>
+#include <thread>
 
 #include "type.hpp"
 
@@ -21,36 +27,80 @@ public:
     virtual ~RandNumGenerator() {}
 };
 
-class StdRandNumGenerator : public RandNumGenerator
+// xoshiro256** による乱数生成器 (状態は 32 byte, ヒープ確保なし)
+// 範囲指定の整数は Lemire の方法 (乗算 + まれな棄却) で偏りなく生成する
+class StdRandNumGenerator final : public RandNumGenerator
 {
-    std::random_device *rd;
-    std::mt19937 *mt;
+    uint64_t s_[4];
+
+    static uint64_t rotl(const uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
 
 public:
     StdRandNumGenerator()
     {
-        rd = new std::random_device();
-        mt = new std::mt19937((*rd)());
+        std::random_device rd;
+        seed(((uint64_t)rd() << 32) ^ rd());
+    }
+    explicit StdRandNumGenerator(uint64_t seed_value)
+    {
+        seed(seed_value);
     }
-    ~StdRandNumGenerator()
+    // splitmix64 で状態を初期化
+    void seed(uint64_t seed_value)
     {
-        delete mt;
-        delete rd;
+        for (int i = 0; i < 4; i++)
+        {
+            uint64_t z = (seed_value += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            s_[i] = z ^ (z >> 31);
+        }
     }
+    uint64_t next()
+    {
+        const uint64_t result = rotl(s_[1] * 5, 7) * 9;
+        const uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl(s_[3], 45);
+        return result;
+    }
+    // [0, upper_bound) の整数
     vertex_id_t gen(vertex_id_t upper_bound)
     {
-        std::uniform_int_distribution<vertex_id_t> dis(0, upper_bound - 1);
-        return dis(*mt);
+        __uint128_t m = (__uint128_t)next() * upper_bound;
+        uint64_t low = (uint64_t)m;
+        if (low < upper_bound)
+        {
+            uint64_t threshold = -upper_bound % upper_bound;
+            while (low < threshold)
+            {
+                m = (__uint128_t)next() * upper_bound;
+                low = (uint64_t)m;
+            }
+        }
+        return m >> 64;
     }
+    // [mi, ma] の整数
     host_id_t genRandHostId(host_id_t mi, host_id_t ma)
     {
-        std::uniform_int_distribution<vertex_id_t> dis(mi, ma);
-        return dis(*mt);
+        return mi + gen((vertex_id_t)ma - mi + 1);
     }
+    // [0, upper_bound) の実数
     float gen_float(float upper_bound)
     {
-        std::uniform_real_distribution<float> dis(0.0, upper_bound);
-        return dis(*mt);
+        return (next() >> 40) * 0x1.0p-24f * upper_bound;
+    }
+    // [0, 1) の実数 (53bit 精度)
+    double gen_double()
+    {
+        return (next() >> 11) * 0x1.0p-53;
     }
 };
 
@@ -74,4 +124,32 @@ public:
         std::chrono::duration<double> val = std::chrono::system_clock::now().time_since_epoch();
         return val.count();
     }
-};
\ No newline at end of file
+};
+
+// 呼び出したスレッドをコア (core % コア数) に固定する
+inline void pinThreadToCore(const uint32_t &core)
+{
+    uint32_t core_num = std::thread::hardware_concurrency();
+    if (core_num == 0)
+        return;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core % core_num, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0)
+        perror("pthread_setaffinity_np");
+}
+
+// TCP で length Byte を全て送る (途中で切れたら false)
+inline bool sendAll(const int &sockfd, const char *data, const size_t &length)
+{
+    size_t sent = 0;
+    while (sent < length)
+    {
+        ssize_t ret = send(sockfd, data + sent, length - sent, MSG_NOSIGNAL);
+        if (ret <= 0)
+            return false;
+        sent += ret;
+    }
+    return true;
+}
\ No newline at end of file
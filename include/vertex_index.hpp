@@ -0,0 +1,120 @@
+/*
+グローバル頂点 ID からローカル頂点 ID への対応表
+オープンアドレス法 (線形探査) のハッシュ表で, 構築後は読み込み専用なのでロックなしで参照できる
+スロット配列はそのままパーティションファイルに書き出し, mmap して使うことができる
+
+build メソッド:
+ローカル ID 順に並んだグローバル ID の配列からスロット配列を構築します。
+スロット数は要素数の 2 倍以上の 2 の冪 (負荷率 0.5 以下) にします。
+
+attach メソッド:
+構築済みのスロット配列 (メモリ上 or mmap 領域) を参照するように設定します。
+
+find メソッド:
+グローバル ID に対応するローカル ID を返します。存在しない場合は INF を返します。
+
+prefetch メソッド:
+グローバル ID が入っているはずのスロットをソフトウェアプリフェッチします。
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "type.hpp"
+#include "../config/param.hpp"
+
+// ハッシュ表のスロット (16 byte)
+struct VertexIndexSlot
+{
+    vertex_id_t global_id; // グローバル頂点 ID
+    local_id_t local_id;   // ローカル頂点 ID (空きスロットは INF)
+    uint32_t reserved;     // 予備
+};
+
+// 頂点 ID のハッシュ (murmur3 の finalizer)
+inline uint64_t hashVertexId(vertex_id_t v)
+{
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdULL;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ULL;
+    v ^= v >> 33;
+    return v;
+}
+
+class VertexIndex
+{
+
+public:
+    // global_ids[local] = global となるスロット配列を構築
+    static void build(const vertex_id_t *global_ids, const local_id_t &num, std::vector<VertexIndexSlot> &slots);
+
+    // スロット配列を参照する
+    void attach(const VertexIndexSlot *slots, const uint64_t &slot_num);
+
+    // グローバル ID -> ローカル ID (存在しなければ INF)
+    local_id_t find(const vertex_id_t &global_id) const;
+
+    // グローバル ID のスロットをプリフェッチ
+    void prefetch(const vertex_id_t &global_id) const;
+
+    // スロット数を入手
+    uint64_t getSlotNum() const;
+
+private:
+    const VertexIndexSlot *slots_ = nullptr;
+    uint64_t mask_ = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+inline void VertexIndex::build(const vertex_id_t *global_ids, const local_id_t &num, std::vector<VertexIndexSlot> &slots)
+{
+    uint64_t slot_num = 1;
+    while (slot_num < (uint64_t)num * 2)
+        slot_num <<= 1;
+
+    VertexIndexSlot empty = {0, INF, 0};
+    slots.assign(slot_num, empty);
+
+    uint64_t mask = slot_num - 1;
+    for (local_id_t local = 0; local < num; local++)
+    {
+        uint64_t pos = hashVertexId(global_ids[local]) & mask;
+        while (slots[pos].local_id != INF)
+            pos = (pos + 1) & mask;
+        slots[pos].global_id = global_ids[local];
+        slots[pos].local_id = local;
+    }
+}
+
+inline void VertexIndex::attach(const VertexIndexSlot *slots, const uint64_t &slot_num)
+{
+    slots_ = slots;
+    mask_ = slot_num - 1;
+}
+
+inline local_id_t VertexIndex::find(const vertex_id_t &global_id) const
+{
+    uint64_t pos = hashVertexId(global_id) & mask_;
+    while (slots_[pos].local_id != INF)
+    {
+        if (slots_[pos].global_id == global_id)
+            return slots_[pos].local_id;
+        pos = (pos + 1) & mask_;
+    }
+    return INF;
+}
+
+inline void VertexIndex::prefetch(const vertex_id_t &global_id) const
+{
+    __builtin_prefetch(&slots_[hashVertexId(global_id) & mask_]);
+}
+
+inline uint64_t VertexIndex::getSlotNum() const
+{
+    return mask_ + 1;
+}
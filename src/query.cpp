@@ -0,0 +1,169 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "../include/query_manager.hpp"
+
+// 起点の持ち主のワーカーに TCP で接続 (接続は使い回す)
+int connectToWorker(const in_addr_t &worker_ip)
+{
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0)
+    {
+        perror("socket");
+        exit(1); // 異常終了
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(struct sockaddr_in));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(QUERY_PORT);
+    addr.sin_addr.s_addr = worker_ip;
+    if (connect(sockfd, (struct sockaddr *)&addr, sizeof(struct sockaddr_in)) < 0)
+    {
+        perror("connect");
+        exit(1); // 異常終了
+    }
+
+    int nodelay = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return sockfd;
+}
+
+// 「起点頂点を受け付けて, その頂点の持ち主のワーカーに PPR クエリを送り, 上位の頂点を表示する」クライアント
+int main(int argc, char *argv[])
+{
+    // 分割数 (頂点 v の持ち主は server.txt の v % 分割数 行目のワーカー)
+    int split_num = 0;
+    std::cout << "分割数？" << std::endl;
+    std::cin >> split_num;
+
+    // partition_graph で分割したときは, 頂点の持ち主をファイル (1 行 1 頂点で "頂点 持ち主") から読む
+    std::unordered_map<vertex_id_t, int> owner;
+    std::string owner_path;
+    std::cout << "頂点の持ち主のファイル？(partition_graph の owner.txt, v % 分割数 なら -)" << std::endl;
+    std::cin >> owner_path;
+    if (owner_path != "-")
+    {
+        std::ifstream owner_file(owner_path);
+        if (!owner_file)
+        {
+            perror("open owner file");
+            exit(1); // 異常終了
+        }
+        vertex_id_t node_id;
+        int worker_id;
+        while (owner_file >> node_id >> worker_id)
+            owner[node_id] = worker_id;
+    }
+
+    uint32_t RWer_num = 0;
+    std::cout << "RW実行回数？(1 クエリあたり)" << std::endl;
+    std::cin >> RWer_num;
+
+    uint32_t top_k = 0;
+    std::cout << "上位何個の頂点を返すか？" << std::endl;
+    std::cin >> top_k;
+
+    // ワーカーの IP アドレス
+    std::vector<in_addr_t> worker_ip;
+    {
+        std::ifstream reading_file;
+        reading_file.open("../config/server.txt", std::ios::in);
+        std::string reading_line_buffer;
+        while (std::getline(reading_file, reading_line_buffer))
+        {
+            worker_ip.emplace_back(inet_addr(reading_line_buffer.c_str()));
+        }
+    }
+    if (split_num <= 0 || split_num > (int)worker_ip.size())
+    {
+        std::cerr << "分割数は 1 以上 server.txt のワーカー数 (" << worker_ip.size() << ") 以下にしてください: " << split_num << std::endl;
+        exit(1); // 異常終了
+    }
+    std::vector<int> sockfds(split_num, -1);
+
+    vertex_id_t source_node;
+    std::cout << "起点頂点？(Ctrl-D で終了)" << std::endl;
+    while (std::cin >> source_node)
+    {
+        int worker_id = source_node % split_num;
+        if (owner_path != "-")
+        {
+            auto it = owner.find(source_node);
+            if (it == owner.end())
+            {
+                std::cout << "source " << source_node << " is not found" << std::endl;
+                continue;
+            }
+            worker_id = it->second;
+        }
+        if (worker_id < 0 || worker_id >= split_num)
+        { // owner.txt の持ち主が分割数の範囲外
+            std::cerr << "source " << source_node << ": worker_id " << worker_id << " is out of range [0, " << split_num << ")" << std::endl;
+            continue;
+        }
+        if (sockfds[worker_id] < 0)
+            sockfds[worker_id] = connectToWorker(worker_ip[worker_id]);
+        int sockfd = sockfds[worker_id];
+
+        auto start = std::chrono::system_clock::now();
+
+        // 要求: ver_id (1B), 起点 (8B), RWer 数 (4B), 上位何個返すか (4B)
+        char request[QUERY_REQUEST_LENGTH];
+        *(uint8_t *)request = QUERY;
+        memcpy(request + 1, &source_node, sizeof(uint64_t));
+        memcpy(request + 9, &RWer_num, sizeof(uint32_t));
+        memcpy(request + 13, &top_k, sizeof(uint32_t));
+        send(sockfd, request, QUERY_REQUEST_LENGTH, 0);
+
+        // 応答: ver_id (1B), query_id (4B), 全ての RWer が戻ってきたか (1B), 処理時間 (8B), 頂点数 (4B), {頂点 (8B), 推定値 (8B)} * 頂点数
+        char header[QUERY_RESPONSE_HEADER_LENGTH];
+        if (recv(sockfd, header, QUERY_RESPONSE_HEADER_LENGTH, MSG_WAITALL) != QUERY_RESPONSE_HEADER_LENGTH)
+        {
+            perror("recv");
+            exit(1); // 異常終了
+        }
+        uint32_t query_id = *(uint32_t *)(header + 1);
+        bool completed = *(uint8_t *)(header + 5);
+        double latency = *(double *)(header + 6);
+        uint32_t result_num = *(uint32_t *)(header + 14);
+        std::vector<char> entries(QUERY_RESPONSE_ENTRY_LENGTH * result_num);
+        if (result_num > 0 && recv(sockfd, entries.data(), entries.size(), MSG_WAITALL) != (ssize_t)entries.size())
+        {
+            perror("recv");
+            exit(1); // 異常終了
+        }
+
+        std::chrono::duration<double> round_trip = std::chrono::system_clock::now() - start;
+
+        if (query_id == 0)
+        {
+            std::cout << "source " << source_node << " is not found" << std::endl;
+            continue;
+        }
+        std::cout << "query_id: " << query_id << ", source: " << source_node << (completed ? "" : " (timeout)")
+                  << ", worker_time: " << latency * 1000 << " ms, round_trip: " << round_trip.count() * 1000 << " ms" << std::endl;
+        for (uint32_t i = 0; i < result_num; i++)
+        {
+            uint64_t node_id = *(uint64_t *)(entries.data() + QUERY_RESPONSE_ENTRY_LENGTH * i);
+            double score = *(double *)(entries.data() + QUERY_RESPONSE_ENTRY_LENGTH * i + 8);
+            std::cout << node_id << " " << score << std::endl;
+        }
+    }
+
+    for (int sockfd : sockfds)
+    {
+        if (sockfd >= 0)
+            close(sockfd);
+    }
+}
@@ -31,22 +31,13 @@ int main(int argc, char *argv[])
     std::cout << "RW実行回数？(1 頂点あたりの)" << std::endl;
     std::cin >> RW_num;
 
-    // 待機時間
-    int32_t wait_time = 0;
-    std::cout << "待機時間？" << std::endl;
-    std::cin >> wait_time;
-
     StartManager start(split_num);
 
+    // 全ワーカーのキャッシュ生成用 RW が終了するまで (sendStartCache の中で) 待つ
     start.sendStartCache();
 
-    std::this_thread::sleep_for(std::chrono::seconds(15));
-
     start.sendStart(ofs_time, ofs_rerun, RW_num);
 
-    std::this_thread::sleep_for(std::chrono::seconds(wait_time));
-
-    start.sendEnd(ofs_time, ofs_rerun);
-
-    std::this_thread::sleep_for(std::chrono::seconds(10));
+    // 全ワーカーの RWer が終了して結果が揃うまで待つ
+    start.receiveResults(ofs_time, ofs_rerun);
 }
\ No newline at end of file
@@ -23,5 +23,14 @@ int main() {
 
     RandomWalker RWer2(message);
     RWer2.printRWer();
+
+    RWer2.compactPath();
+    RWer2.printRWer();
+    cout << RWer2.getCurrentNodeID() << " " << RWer2.getPrevNodeID() << endl;
+
+    RWer2.writeMessage(message);
+    RandomWalker RWer3(message);
+    RWer3.updateRWer(4, 12345, 300, 555, 666);
+    RWer3.printRWer();
     return 0;
 }
\ No newline at end of file